@@ -5,7 +5,9 @@
 #include <v8.h>
 
 #include <cstdint>
+#include <string>
 #include <type_traits>
+#include <utility>
 
 struct _arg {};
 
@@ -33,6 +35,18 @@ struct _ref_def {};
 #define V8_FN(r, m, ...) static_cast<r(*)(__VA_ARGS__)>(&m)
 #define V8_MEMFN(t, r, m, ...) static_cast<r(t::*)(__VA_ARGS__)>(&t::m)
 
+/**
+ * Bind a function or member function as a template argument, e.g. addFunction<V8_BIND_FN(&Foo::bar)>("bar"),
+ * so the call is resolved at compile time. With C++17 addFunction<&Foo::bar>("bar") can be used as well.
+ */
+#define V8_BIND_FN(...) decltype(__VA_ARGS__), __VA_ARGS__
+
+#if defined(__cpp_nontype_template_parameter_auto) || __cplusplus >= 201703L
+#define V8_BIND_AUTO 1
+#else
+#define V8_BIND_AUTO 0
+#endif
+
 template<typename T>
 struct CppArgHolder
 {
@@ -46,9 +60,16 @@ struct CppArgHolder
         return holder;
     }
 
-    void hold(const T &v)
+    template<typename TYPE>
+    void read(v8::MaybeLocal<v8::Value> handle)
+    {
+        holder = V8Type<TYPE>::get(handle);
+    }
+
+    template<typename TYPE, typename DEF>
+    void read(v8::MaybeLocal<v8::Value> handle, const DEF &def)
     {
-        holder = v;
+        holder = V8Type<TYPE>::opt(handle, def);
     }
 
     T holder;
@@ -62,19 +83,71 @@ struct CppArgHolder<T &>
         return *holder;
     }
 
-    void hold(T &v)
+    template<typename TYPE>
+    void read(v8::MaybeLocal<v8::Value> handle)
     {
-        holder = &v;
+        holder = &V8Type<TYPE>::get(handle);
+    }
+
+    template<typename TYPE, typename DEF>
+    void read(v8::MaybeLocal<v8::Value> handle, const DEF &def)
+    {
+        holder = &V8Type<TYPE>::opt(handle, def);
     }
 
     T *holder;
 };
 
+/**
+ * String arguments are decoded straight into the storage of their holder,
+ * so every argument of a call has its own buffer valid for the duration of the call.
+ */
+template<typename T>
+struct CppArgStringHolder
+{
+    CppArgStringHolder() {}
+
+    CppArgStringHolder(const CppArgStringHolder &) = delete;
+
+    T &value()
+    {
+        return holder;
+    }
+
+    const T &value() const
+    {
+        return holder;
+    }
+
+    template<typename TYPE>
+    void read(v8::MaybeLocal<v8::Value> handle)
+    {
+        holder = V8Type<TYPE>::get(handle, storage);
+    }
+
+    template<typename TYPE, typename DEF>
+    void read(v8::MaybeLocal<v8::Value> handle, const DEF &def)
+    {
+        holder = V8Type<TYPE>::opt(handle, def, storage);
+    }
+
+    T holder{};
+    std::string storage;
+};
+
+template<>
+struct CppArgHolder<V8StringView>
+    : CppArgStringHolder<V8StringView> {};
+
+template<>
+struct CppArgHolder<const char *>
+    : CppArgStringHolder<const char *> {};
+
 template<typename T>
 struct CppArgTraits
 {
     using Type = T;
-    using ValueType = typename std::result_of<decltype(&V8Type<T>::get)(v8::MaybeLocal<v8::Value>)>::type;
+    using ValueType = decltype(V8Type<T>::get(std::declval<v8::Local<v8::Object>>()));
     using HolderType = CppArgHolder<ValueType>;
 
     static constexpr bool isInput = true;
@@ -157,7 +230,7 @@ struct CppArgInput<Traits, true, false, HasDefault>
 {
     static void get(v8::MaybeLocal<v8::Value> handle, typename Traits::HolderType &r)
     {
-        r.hold(V8Type<typename Traits::Type>::get(handle));
+        r.template read<typename Traits::Type>(handle);
     }
 };
 
@@ -167,7 +240,7 @@ struct CppArgInput<Traits, true, true, false>
     static void get(v8::MaybeLocal<v8::Value> handle, typename Traits::HolderType &r)
     {
         using DefaultType = typename std::decay<typename Traits::ValueType>::type;
-        r.hold(V8Type<typename Traits::Type>::opt(handle, DefaultType()));
+        r.template read<typename Traits::Type>(handle, DefaultType());
     }
 };
 
@@ -176,7 +249,7 @@ struct CppArgInput<Traits, true, true, true>
 {
     static void get(v8::MaybeLocal<v8::Value> handle, typename Traits::HolderType &r)
     {
-        r.hold(V8Type<typename Traits::Type>::opt(handle, Traits::defaultValue));
+        r.template read<typename Traits::Type>(handle, Traits::defaultValue);
     }
 };
 
@@ -220,22 +293,132 @@ template<typename... P>
 using CppArgTuple = std::tuple<typename CppArg<P>::HolderType...>;
 
 template<typename... P>
-struct CppArgTupleInput;
+struct CppArgTupleRead;
 
 template<>
-struct CppArgTupleInput<>
+struct CppArgTupleRead<>
 {
     template<typename... T>
     static void get(const v8::FunctionCallbackInfo<v8::Value> &, int index, std::tuple<T...> &) {}
 };
 
 template<typename P0, typename... P>
-struct CppArgTupleInput<P0, P...>
+struct CppArgTupleRead<P0, P...>
 {
     template<typename... T>
     static void get(const v8::FunctionCallbackInfo<v8::Value> &args, int index, std::tuple<T...> &t)
     {
         CppArg<P0>::get(args[index], std::get<sizeof...(T) - sizeof...(P) - 1>(t));
-        CppArgTupleInput<P...>::get(args, index + 1, t);
+        CppArgTupleRead<P...>::get(args, index + 1, t);
     }
-};
\ No newline at end of file
+};
+
+/**
+ * Convert the call arguments into the holder tuple. Returns false when a conversion threw,
+ * the exception is left pending and the bound function must not be called.
+ */
+template<typename... P>
+struct CppArgTupleInput
+{
+    template<typename... T>
+    static bool get(const v8::FunctionCallbackInfo<v8::Value> &args, int index, std::tuple<T...> &t)
+    {
+        v8::TryCatch tryCatch(args.GetIsolate());
+        CppArgTupleRead<P...>::get(args, index, t);
+        if (tryCatch.HasCaught())
+        {
+            tryCatch.ReThrow();
+            return false;
+        }
+        return true;
+    }
+};
+
+template<>
+struct CppArgTupleInput<>
+{
+    template<typename... T>
+    static bool get(const v8::FunctionCallbackInfo<v8::Value> &, int, std::tuple<T...> &)
+    {
+        return true;
+    }
+};
+
+/**
+ * Argument of a vector function: either a TypedArray of the argument type, read element by element,
+ * or a single number broadcast to every element (stride 0).
+ */
+template<typename T>
+struct CppVectorArg
+{
+    using Type = typename std::decay<T>::type;
+
+    static_assert(V8TypedArrayTraits<Type>::exists, "vector function arguments must be numeric types with a TypedArray");
+
+    CppVectorArg() {}
+
+    CppVectorArg(const CppVectorArg &) = delete;
+
+    bool get(v8::Local<v8::Value> value, size_t &size, bool &isArray)
+    {
+        if (V8TypedArrayTraits<Type>::is(value))
+        {
+            auto array = value.As<typename V8TypedArrayTraits<Type>::ArrayType>();
+            size_t length = array->Length();
+            if (isArray && length != size)
+            {
+                v8::Isolate::GetCurrent()->ThrowException(v8::Exception::RangeError(v8::String::NewFromUtf8(v8::Isolate::GetCurrent(), "except typed arrays of the same length", v8::NewStringType::kNormal).ToLocalChecked()));
+                return false;
+            }
+            size = length;
+            isArray = true;
+            data = reinterpret_cast<const Type *>(static_cast<const char *>(V8ArrayBufferData(array->Buffer())) + array->ByteOffset());
+            stride = 1;
+        }
+        else if (value->IsNumber() || value->IsBoolean())
+        {
+            scalar = V8Type<Type>::get(value);
+            data = &scalar;
+            stride = 0;
+        }
+        else
+        {
+            v8::Isolate::GetCurrent()->ThrowException(v8::Exception::TypeError(v8::String::NewFromUtf8(v8::Isolate::GetCurrent(), "except number or typed array", v8::NewStringType::kNormal).ToLocalChecked()));
+            return false;
+        }
+        return true;
+    }
+
+    Type operator[](size_t index) const
+    {
+        return data[index * stride];
+    }
+
+    const Type *data{ nullptr };
+    size_t stride{ 0 };
+    Type scalar{};
+};
+
+template<typename... P>
+struct CppVectorArgInput;
+
+template<>
+struct CppVectorArgInput<>
+{
+    template<typename... T>
+    static bool get(const v8::FunctionCallbackInfo<v8::Value> &, int, std::tuple<T...> &, size_t &, bool &)
+    {
+        return true;
+    }
+};
+
+template<typename P0, typename... P>
+struct CppVectorArgInput<P0, P...>
+{
+    template<typename... T>
+    static bool get(const v8::FunctionCallbackInfo<v8::Value> &args, int index, std::tuple<T...> &t, size_t &size, bool &isArray)
+    {
+        return std::get<sizeof...(T) - sizeof...(P) - 1>(t).get(args[index], size, isArray)
+            && CppVectorArgInput<P...>::get(args, index + 1, t, size, isArray);
+    }
+};
@@ -1,7 +1,11 @@
 #pragma once
 
 #include "CppArg.h"
+#include "CppBindOverload.h"
+#include "CppFastCall.h"
 #include "CppObject.h"
+#include "V8Async.h"
+#include "V8Isolate.h"
 #include "V8Type.h"
 
 #include <v8.h>
@@ -13,6 +17,32 @@ enum CppBindMethodCheck
     CHK_SETTER
 };
 
+/**
+ * Copy a bound function object into the isolate data and wrap it for use as callback data.
+ */
+template<typename FN>
+v8::Local<v8::External> CppBindFunctionData(const FN &fn)
+{
+    auto isolate = v8::Isolate::GetCurrent();
+    return v8::External::New(isolate, V8IsolateData::get(isolate).retain(new FN(fn)));
+}
+
+/**
+ * Create the function template of a bound function, with the generated fast API function if PROC has one
+ * and fast is set.
+ */
+template<typename PROC>
+v8::Local<v8::FunctionTemplate> CppBindFunctionTemplate(v8::Local<v8::Value> data, v8::Local<v8::Signature> signature = v8::Local<v8::Signature>(), bool fast = true)
+{
+#if V8_BINDING_FAST_API
+    return v8::FunctionTemplate::New(v8::Isolate::GetCurrent(), &PROC::call, data, signature, 0,
+                                     v8::ConstructorBehavior::kAllow, v8::SideEffectType::kHasSideEffect, fast ? PROC::Fast::function() : nullptr);
+#else
+    (void)fast;
+    return v8::FunctionTemplate::New(v8::Isolate::GetCurrent(), &PROC::call, data, signature);
+#endif
+}
+
 template <typename T, typename PT = T>
 struct CppBindVariableGetter
 {
@@ -20,7 +50,7 @@ struct CppBindVariableGetter
     {
         auto ptr = static_cast<const T*>(v8Args.Data().As<v8::External>()->Value());
         assert(ptr);
-        v8Args.GetReturnValue().Set(V8Type<PT>::set(*ptr));
+        V8ReturnValue<PT>::set(v8Args.GetReturnValue(), *ptr);
     }
 };
 
@@ -41,13 +71,38 @@ struct CppBindMethodBase
     static_assert(CHK != CHK_GETTER || (!std::is_same<R, void>::value && sizeof...(P) == 0), "the specified function is not getter function");
     static_assert(CHK != CHK_SETTER || (std::is_same<R, void>::value && sizeof...(P) == 1), "the specified function is not setter function");
 
+    using FunctionType = FN;
+
+    template<typename SOURCE>
+    using FastCall = CppFastMethod<SOURCE, R, P...>;
+
+    using Fast = FastCall<CppFastDataFunction<FN>>;
+
+    template<template<typename, typename, typename...> class PROC>
+    using Rebind = PROC<FN, R, P...>;
+
     static void call(const v8::FunctionCallbackInfo<v8::Value> &v8Args)
     {
         const FN &fn = *reinterpret_cast<const FN *>(v8Args.Data().As<v8::External>()->Value());
         assert(fn);
+        invoke(fn, v8Args);
+    }
+
+    using Arguments = CppArgMatch<P...>;
+
+    static bool match(const v8::FunctionCallbackInfo<v8::Value> &v8Args)
+    {
+        return Arguments::is(v8Args);
+    }
+
+    static void invoke(const FN &fn, const v8::FunctionCallbackInfo<v8::Value> &v8Args)
+    {
         CppArgTuple<P...> args;
-        CppArgTupleInput<P...>::get(v8Args, 0, args);
-        v8Args.GetReturnValue().Set(CppInvokeMethod<FN, R, typename CppArg<P>::HolderType...>::call(fn, args));
+        if (!CppArgTupleInput<P...>::get(v8Args, 0, args))
+        {
+            return;
+        }
+        CppInvokeMethod<FN, R, typename CppArg<P>::HolderType...>::call(fn, args, v8Args.GetReturnValue());
     }
 
     template<typename PROC>
@@ -115,7 +170,10 @@ struct CppBindClassConstructor<T, T, _arg(*)(P...)>
     static void call(const v8::FunctionCallbackInfo<v8::Value> &v8Args)
     {
         CppArgTuple<P...> args;
-        CppArgTupleInput<P...>::get(v8Args, 0, args);
+        if (!CppArgTupleInput<P...>::get(v8Args, 0, args))
+        {
+            return;
+        }
         CppObjectValue<T>::instance(v8Args.This(), args);
     }
 };
@@ -126,7 +184,10 @@ struct CppBindClassConstructor<SP, T, _arg(*)(P...)>
     static void call(const v8::FunctionCallbackInfo<v8::Value> &v8Args)
     {
         CppArgTuple<P...> args;
-        CppArgTupleInput<P...>::get(v8Args, 0, args);
+        if (!CppArgTupleInput<P...>::get(v8Args, 0, args))
+        {
+            return;
+        }
         T *obj = CppInvokeClassConstructor<T>::call(args);
         CppObjectSharedPtr<SP, T>::instance(v8Args.This(), obj);
     }
@@ -139,8 +200,13 @@ struct CppBindClassVariableGetter
     {
         auto member = static_cast<V T::* *>(v8Args.Data().As<v8::External>()->Value());
         assert(member);
-        const T *obj = CppObject::get<T>(v8Args.This());
-        v8Args.GetReturnValue().Set(V8Type<PV>::set(obj->**member));
+        CppObject *object = CppObject::getObject<T>(v8Args.This());
+        if (object == nullptr)
+        {
+            return;
+        }
+        const T *obj = object->template objectAs<T>();
+        V8ReturnValue<PV>::set(v8Args.GetReturnValue(), obj->**member);
     }
 };
 
@@ -151,11 +217,93 @@ struct CppBindClassVariableSetter
     {
         auto member = static_cast<V T::* *>(v8Args.Data().As<v8::External>()->Value());
         assert(member);
-        const T *obj = CppObject::get<T>(v8Args.This());
+        CppObject *object = CppObject::getObject<T>(v8Args.This());
+        if (object == nullptr)
+        {
+            return;
+        }
+        T *obj = object->template objectAs<T>();
         obj->**member = V8Type<V>::get(value);
     }
 };
 
+/**
+ * Results of a batch call, one per receiver. Numeric results are written straight into the backing store
+ * of a preallocated TypedArray, other results are converted into an array after the loop.
+ */
+template<typename R, typename ENABLED = void>
+struct CppBatchOutput
+{
+    using ValueType = typename std::decay<R>::type;
+
+    explicit CppBatchOutput(uint32_t size)
+    {
+        values.reserve(size);
+    }
+
+    template<typename DISPATCH, typename... A>
+    void add(uint32_t, A &&... args)
+    {
+        values.push_back(DISPATCH::call(std::forward<A>(args)...));
+    }
+
+    v8::Local<v8::Value> result() const
+    {
+        std::vector<v8::Local<v8::Value>> elements;
+        elements.reserve(values.size());
+        for (const auto &value : values)
+        {
+            elements.push_back(V8Type<ValueType>::set(value));
+        }
+        return V8ArrayNew(elements);
+    }
+
+    std::vector<ValueType> values;
+};
+
+template<typename R>
+struct CppBatchOutput<R, typename std::enable_if<V8TypedArrayTraits<typename std::decay<R>::type>::exists && !std::is_same<typename std::decay<R>::type, char>::value>::type>
+{
+    using ValueType = typename std::decay<R>::type;
+
+    explicit CppBatchOutput(uint32_t size)
+        : buffer(v8::ArrayBuffer::New(v8::Isolate::GetCurrent(), size * sizeof(ValueType))),
+          values(static_cast<ValueType *>(V8ArrayBufferData(buffer))),
+          size(size) {}
+
+    template<typename DISPATCH, typename... A>
+    void add(uint32_t index, A &&... args)
+    {
+        values[index] = DISPATCH::call(std::forward<A>(args)...);
+    }
+
+    v8::Local<v8::Value> result() const
+    {
+        return V8TypedArrayTraits<ValueType>::ArrayType::New(buffer, 0, size);
+    }
+
+    v8::Local<v8::ArrayBuffer> buffer;
+    ValueType *values;
+    uint32_t size;
+};
+
+template<>
+struct CppBatchOutput<void>
+{
+    explicit CppBatchOutput(uint32_t) {}
+
+    template<typename DISPATCH, typename... A>
+    void add(uint32_t, A &&... args)
+    {
+        DISPATCH::call(std::forward<A>(args)...);
+    }
+
+    v8::Local<v8::Value> result() const
+    {
+        return v8::Undefined(v8::Isolate::GetCurrent());
+    }
+};
+
 template<int CHK, typename T, bool IS_PROXY, bool IS_CONST, typename FN, typename R, typename... P>
 struct CppBindClassMethodBase
 {
@@ -163,14 +311,97 @@ struct CppBindClassMethodBase
     static_assert(CHK != CHK_SETTER || (std::is_same<R, void>::value && sizeof...(P) == 1), "the specified function is not setter function");
     static constexpr bool isConst = IS_CONST;
 
+    using FunctionType = FN;
+
+    template<typename SOURCE>
+    using FastCall = CppFastClassMethod<T, IS_PROXY, SOURCE, R, P...>;
+
+    using Fast = FastCall<CppFastDataFunction<FN>>;
+
+    template<template<typename, bool, typename, typename, typename...> class PROC>
+    using Rebind = PROC<T, IS_PROXY, FN, R, P...>;
+
     static void call(const v8::FunctionCallbackInfo<v8::Value> &v8Args)
     {
         auto fn = static_cast<const FN *>(v8Args.Data().As<v8::External>()->Value());
         assert(fn);
+        invoke(*fn, v8Args);
+    }
+
+    using Arguments = CppArgMatch<P...>;
+
+    static bool match(const v8::FunctionCallbackInfo<v8::Value> &v8Args)
+    {
+        return Arguments::is(v8Args);
+    }
+
+    static void invoke(const FN &fn, const v8::FunctionCallbackInfo<v8::Value> &v8Args)
+    {
+        CppObject *object = CppObject::getObject<T>(v8Args.This());
+        if (object == nullptr)
+        {
+            return;
+        }
+        T *obj = object->template objectAs<T>();
+        CppArgTuple<P...> args;
+        if (!CppArgTupleInput<P...>::get(v8Args, 0, args))
+        {
+            return;
+        }
+        CppInvokeClassMethod<T, IS_PROXY, FN, R, typename CppArg<P>::HolderType...>::call(obj, fn, args, v8Args.GetReturnValue());
+    }
+
+    /**
+     * Batch variant: call the method on every object of the array passed as first argument,
+     * with the remaining arguments converted once and shared by all calls.
+     * All receivers are checked before the first call, so a bad element leaves every object untouched.
+     * A call that leaves an exception pending stops the loop, the exception is rethrown.
+     */
+    static void batch(const v8::FunctionCallbackInfo<v8::Value> &v8Args)
+    {
+        using Dispatch = CppDispatchClassMethod<T, IS_PROXY, FN, R, CppArgTuple<P...>, sizeof...(P)>;
+        auto fn = static_cast<const FN *>(v8Args.Data().As<v8::External>()->Value());
+        assert(fn);
+        if (!v8Args[0]->IsArray())
+        {
+            v8::Isolate::GetCurrent()->ThrowException(v8::Exception::TypeError(v8::String::NewFromUtf8(v8::Isolate::GetCurrent(), "except array of cpp objects", v8::NewStringType::kNormal).ToLocalChecked()));
+            return;
+        }
+        auto objects = v8Args[0].As<v8::Array>();
+        auto context = v8::Isolate::GetCurrent()->GetCurrentContext();
         CppArgTuple<P...> args;
-        T *obj = CppObject::get<T>(v8Args.This());
-        CppArgTupleInput<P...>::get(v8Args, 0, args);
-        v8Args.GetReturnValue().Set(CppInvokeClassMethod<T, IS_PROXY, FN, R, typename CppArg<P>::HolderType...>::call(obj, fn, args));
+        if (!CppArgTupleInput<P...>::get(v8Args, 1, args))
+        {
+            return;
+        }
+        auto size = objects->Length();
+        std::vector<T *> receivers(size);
+        for (uint32_t i = 0; i < size; ++i)
+        {
+            v8::HandleScope scope(v8::Isolate::GetCurrent());
+            v8::Local<v8::Value> element;
+            if (objects->Get(context, i).ToLocal(&element) && element->IsObject())
+            {
+                receivers[i] = CppObject::cast<T>(element.As<v8::Object>());
+            }
+            if (receivers[i] == nullptr)
+            {
+                v8::Isolate::GetCurrent()->ThrowException(v8::Exception::TypeError(v8::String::NewFromUtf8(v8::Isolate::GetCurrent(), "except array of cpp objects", v8::NewStringType::kNormal).ToLocalChecked()));
+                return;
+            }
+        }
+        CppBatchOutput<R> output(size);
+        v8::TryCatch tryCatch(v8Args.GetIsolate());
+        for (uint32_t i = 0; i < size; ++i)
+        {
+            output.template add<Dispatch>(i, receivers[i], *fn, args);
+            if (tryCatch.HasCaught())
+            {
+                tryCatch.ReThrow();
+                return;
+            }
+        }
+        v8Args.GetReturnValue().Set(output.result());
     }
 
     template<typename PROC>
@@ -297,6 +528,87 @@ struct CppBindClassMethod<T, FN, _arg(*)(P...), CHK,
     typename std::enable_if<std::is_function<FN>::value>::type>
     : CppBindClassMethod<T, FN *, _arg(*)(P...), CHK> {};
 
+/**
+ * Element-wise variant of a scalar numeric function: every argument can be a TypedArray of its type
+ * or a number broadcast to all elements, and the results are written to a TypedArray passed as extra
+ * last argument, or to a new one. If no argument is an array the scalar result is returned.
+ */
+template<typename FN, typename R, typename... P>
+struct CppBindVectorMethod
+{
+    using ResultType = typename std::decay<R>::type;
+
+    static_assert(V8TypedArrayTraits<ResultType>::exists, "vector function must return a numeric type with a TypedArray");
+
+    using FunctionType = FN;
+
+    template<typename SOURCE>
+    using FastCall = CppFastMethodImpl<false, SOURCE, R>;
+
+    using Fast = FastCall<void>;
+
+    static void call(const v8::FunctionCallbackInfo<v8::Value> &v8Args)
+    {
+        const FN &fn = *reinterpret_cast<const FN *>(v8Args.Data().As<v8::External>()->Value());
+        assert(fn);
+        invoke(fn, v8Args);
+    }
+
+    static void invoke(const FN &fn, const v8::FunctionCallbackInfo<v8::Value> &v8Args)
+    {
+        using ArgsType = std::tuple<CppVectorArg<P>...>;
+        using ArrayType = typename V8TypedArrayTraits<ResultType>::ArrayType;
+        using Dispatch = CppDispatchVector<FN, ResultType, ArgsType, sizeof...(P)>;
+        ArgsType args;
+        size_t size = 0;
+        bool isArray = false;
+        if (!CppVectorArgInput<P...>::get(v8Args, 0, args, size, isArray))
+        {
+            return;
+        }
+        if (!isArray)
+        {
+            ResultType result;
+            Dispatch::call(fn, args, &result, 1);
+            V8ReturnValue<ResultType>::set(v8Args.GetReturnValue(), result);
+            return;
+        }
+        v8::Local<ArrayType> out;
+        auto last = v8Args[static_cast<int>(sizeof...(P))];
+        if (V8TypedArrayTraits<ResultType>::is(last))
+        {
+            out = last.As<ArrayType>();
+            if (out->Length() != size)
+            {
+                v8::Isolate::GetCurrent()->ThrowException(v8::Exception::RangeError(v8::String::NewFromUtf8(v8::Isolate::GetCurrent(), "except output typed array of the same length", v8::NewStringType::kNormal).ToLocalChecked()));
+                return;
+            }
+        }
+        else
+        {
+            out = ArrayType::New(v8::ArrayBuffer::New(v8::Isolate::GetCurrent(), size * sizeof(ResultType)), 0, size);
+        }
+        auto data = reinterpret_cast<ResultType *>(static_cast<char *>(V8ArrayBufferData(out->Buffer())) + out->ByteOffset());
+        Dispatch::call(fn, args, data, size);
+        v8Args.GetReturnValue().Set(out);
+    }
+};
+
+/**
+ * Bound function fixed at compile time (see V8_BIND_FN): PROC is the CppBindMethod or CppBindClassMethod
+ * of the function type, and F is called directly, without callback data or a stored function object.
+ */
+template<typename PROC, typename FN, FN F>
+struct CppBindConstMethod
+{
+    using Fast = typename PROC::template FastCall<CppFastConstFunction<typename PROC::FunctionType, FN, F>>;
+
+    static void call(const v8::FunctionCallbackInfo<v8::Value> &v8Args)
+    {
+        PROC::invoke(static_cast<typename PROC::FunctionType>(F), v8Args);
+    }
+};
+
 #define V8_SP(...) static_cast<__VA_ARGS__*>(nullptr)
 #define V8_DEL(...) static_cast<__VA_ARGS__**>(nullptr)
 
@@ -310,6 +622,7 @@ class CppBindClass
 
 private:
     v8::Local<v8::FunctionTemplate> handle;
+    bool fastCalls{ true };
 
     explicit CppBindClass(v8::Local<v8::FunctionTemplate> handle) : handle(handle) {}
 
@@ -325,7 +638,7 @@ private:
     {
         v8::HandleScope scope(v8::Isolate::GetCurrent());
         v8::Local<v8::FunctionTemplate> handle;
-        auto key = V8Type<const char *>::set(name);
+        auto key = V8Key(name);
         if (parent->HasOwnProperty(key))
         {
             handle = parent->Get(key);
@@ -335,7 +648,8 @@ private:
             handle = v8::FunctionTemplate::New(v8::Isolate::GetCurrent());
             handle->SetClassName(key);
             handle->InstanceTemplate()->SetInternalFieldCount(1);
-            handle->GetFunction()->Set(V8Type<const char *>::set("___parent"), parent);
+            handle->GetFunction()->Set(V8_KEY("___parent"), parent);
+            V8IsolateData::get().templates.setClass(v8::Isolate::GetCurrent(), &CppTypeInfo::get<T>(), handle);
             parent->Set(key, handle);
         }
         return CppBindClass<T, PARENT>(handle);
@@ -346,7 +660,7 @@ private:
     {
         v8::HandleScope scope(v8::Isolate::GetCurrent());
         v8::Local<v8::FunctionTemplate> handle;
-        auto key = V8Type<const char *>::set(name);
+        auto key = V8Key(name);
         if (parent->HasOwnProperty(key))
         {
             handle = parent->Get(key);
@@ -356,18 +670,55 @@ private:
             handle = v8::FunctionTemplate::New(v8::Isolate::GetCurrent());
             handle->SetClassName(key);
             handle->InstanceTemplate()->SetInternalFieldCount(1);
-            handle->GetFunction()->Set(V8Type<const char *>::set("___parent"), parent);
-            handle->Inherit(CppClassPersistent<SUPER>::persistent.Get(v8::Isolate::GetCurrent()));
+            handle->GetFunction()->Set(V8_KEY("___parent"), parent);
+            auto &templates = V8IsolateData::get().templates;
+            handle->Inherit(templates.getClass(v8::Isolate::GetCurrent(), &CppTypeInfo::get<SUPER>()));
+            templates.setClass(v8::Isolate::GetCurrent(), &CppTypeInfo::get<T>(), handle);
+            CppTypeInfo::get<T>().template extend<T, SUPER>();
             parent->Set(key, handle);
         }
         return CppBindClass<T, PARENT>(handle);
     }
 
+    /**
+     * Receiver signature of the class methods, so V8 rejects calls on objects of other classes
+     * before the callback (or the fast API function) is entered.
+     */
+    v8::Local<v8::Signature> signature() const
+    {
+        return v8::Signature::New(v8::Isolate::GetCurrent(), handle);
+    }
+
+    template<typename PROC>
+    v8::Local<v8::FunctionTemplate> functionTemplate(v8::Local<v8::Value> data, v8::Local<v8::Signature> signature = v8::Local<v8::Signature>()) const
+    {
+        return CppBindFunctionTemplate<PROC>(data, signature, fastCalls);
+    }
+
+    template<typename PROC>
+    CppBindClass<T, PARENT> &addBatchFunction(const char *name, v8::Local<v8::External> data)
+    {
+        auto method = functionTemplate<PROC>(data, signature());
+        method->Set(V8_KEY("batch"), v8::FunctionTemplate::New(v8::Isolate::GetCurrent(), &PROC::batch, data), v8::ReadOnly);
+        handle->PrototypeTemplate()->Set(V8Key(name), method, v8::ReadOnly);
+        return *this;
+    }
+
 public:
+    /**
+     * Register the functions and methods added after this call with (default) or without
+     * their generated fast API function, e.g. for methods that must always see the full callback info.
+     */
+    CppBindClass<T, PARENT> &setFastCalls(bool enabled)
+    {
+        fastCalls = enabled;
+        return *this;
+    }
+
     template<typename V>
     CppBindClass<T, PARENT> &addConstant(const char *name, const V &v)
     {
-        handle->Set(V8Type<const char *>::set(name), V8Type<V>::set(v), v8::ReadOnly);
+        handle->Set(V8Key(name), V8Type<V>::set(v), v8::ReadOnly);
         return *this;
     }
 
@@ -375,7 +726,7 @@ public:
     CppBindClass<T, PARENT> &addStaticVariable(const char *name, V *v, bool writable = true)
     {
         v8::HandleScope scope(v8::Isolate::GetCurrent());
-        handle->GetFunction()->SetAccessor(V8Type<const char *>::set(name),
+        handle->GetFunction()->SetAccessor(V8Key(name),
                                            &CppBindVariableGetter<V>::call,
                                            writable ? &CppBindVariableSetter<V>::call : nullptr,
                                            v8::External::New(v8::Isolate::GetCurrent(), v),
@@ -387,7 +738,7 @@ public:
     CppBindClass<T, PARENT> &addStaticVariable(const char *name, const V *v)
     {
         v8::HandleScope scope(v8::Isolate::GetCurrent());
-        handle->GetFunction()->SetAccessor(V8Type<const char *>::set(name),
+        handle->GetFunction()->SetAccessor(V8Key(name),
                                            &CppBindVariableGetter<V>::call,
                                            nullptr,
                                            v8::External::New(v8::Isolate::GetCurrent(), const_cast<V *>(v)),
@@ -400,7 +751,7 @@ public:
     addStaticVariableRef(const char *name, V *v, bool writable = true)
     {
         v8::HandleScope scope(v8::Isolate::GetCurrent());
-        handle->GetFunction()->SetAccessor(V8Type<const char *>::set(name),
+        handle->GetFunction()->SetAccessor(V8Key(name),
                                            &CppBindVariableGetter<V, V &>::call,
                                            writable ? &CppBindVariableSetter<V>::call : nullptr,
                                            v8::External::New(v8::Isolate::GetCurrent(), v),
@@ -413,7 +764,7 @@ public:
     addStaticVariableRef(const char *name, V *v)
     {
         v8::HandleScope scope(v8::Isolate::GetCurrent());
-        handle->GetFunction()->SetAccessor(V8Type<const char *>::set(name),
+        handle->GetFunction()->SetAccessor(V8Key(name),
                                            &CppBindVariableGetter<V, V &>::call,
                                            nullptr,
                                            v8::External::New(v8::Isolate::GetCurrent(), v),
@@ -425,7 +776,7 @@ public:
     CppBindClass<T, PARENT> &addStaticVariableRef(const char *name, const V *v)
     {
         v8::HandleScope scope(v8::Isolate::GetCurrent());
-        handle->GetFunction()->SetAccessor(V8Type<const char *>::set(name),
+        handle->GetFunction()->SetAccessor(V8Key(name),
                                            &CppBindVariableGetter<V, const V &>::call,
                                            nullptr,
                                            v8::External::New(v8::Isolate::GetCurrent(), const_cast<V *>(v)),
@@ -438,9 +789,9 @@ public:
     {
         using CppGetter = CppBindMethod<FG, FG, CHK_GETTER>;
         using CppSetter = CppBindMethod<FS, FS, CHK_SETTER>;
-        handle->GetFunction()->SetAccessorProperty(V8Type<const char *>::set(name),
-                                                   v8::Function::New(v8::Isolate::GetCurrent(), &CppGetter::call, v8::External::New(v8::Isolate::GetCurrent(), CppGetter::function(get))),
-                                                   v8::Function::New(v8::Isolate::GetCurrent(), &CppSetter::call, v8::External::New(v8::Isolate::GetCurrent(), CppSetter::function(set))),
+        handle->GetFunction()->SetAccessorProperty(V8Key(name),
+                                                   v8::Function::New(v8::Isolate::GetCurrent(), &CppGetter::call, CppBindFunctionData(CppGetter::function(get))),
+                                                   v8::Function::New(v8::Isolate::GetCurrent(), &CppSetter::call, CppBindFunctionData(CppSetter::function(set))),
                                                    v8::ReadOnly);
         return *this;
     }
@@ -449,8 +800,8 @@ public:
     CppBindClass<T, PARENT> &addStaticProperty(const char *name, const FN &get)
     {
         using CppGetter = CppBindMethod<FN, FN, CHK_GETTER>;
-        handle->GetFunction()->SetAccessorProperty(V8Type<const char *>::set(name),
-                                                   v8::Function::New(v8::Isolate::GetCurrent(), &CppGetter::call, v8::External::New(v8::Isolate::GetCurrent(), CppGetter::function(get))),
+        handle->GetFunction()->SetAccessorProperty(V8Key(name),
+                                                   v8::Function::New(v8::Isolate::GetCurrent(), &CppGetter::call, CppBindFunctionData(CppGetter::function(get))),
                                                    nullptr,
                                                    v8::ReadOnly);
         return *this;
@@ -460,7 +811,7 @@ public:
     CppBindClass<T, PARENT> &addStaticFunction(const char *name, const FN &proc)
     {
         using CppProc = CppBindMethod<FN>;
-        handle->GetFunction()->Set(V8Type<const char *>::set(name), v8::Function::New(v8::Isolate::GetCurrent(), &CppProc::call, v8::External::New(v8::Isolate::GetCurrent(), CppProc::function(proc))));
+        handle->Set(V8Key(name), functionTemplate<CppProc>(CppBindFunctionData(CppProc::function(proc))));
         return *this;
     }
 
@@ -468,10 +819,88 @@ public:
     CppBindClass<T, PARENT> &addStaticFunction(const char *name, const FN &proc, ARGS)
     {
         using CppProc = CppBindMethod<FN, ARGS>;
-        handle->GetFunction()->Set(V8Type<const char *>::set(name), v8::Function::New(v8::Isolate::GetCurrent(), &CppProc::call, v8::External::New(v8::Isolate::GetCurrent(), CppProc::function(proc))));
+        handle->Set(V8Key(name), functionTemplate<CppProc>(CppBindFunctionData(CppProc::function(proc))));
+        return *this;
+    }
+
+    template<typename FN, FN F>
+    CppBindClass<T, PARENT> &addStaticFunction(const char *name)
+    {
+        using CppProc = CppBindConstMethod<CppBindMethod<FN>, FN, F>;
+        handle->Set(V8Key(name), functionTemplate<CppProc>(v8::Local<v8::Value>()));
+        return *this;
+    }
+
+    template<typename FN, FN F, typename ARGS>
+    CppBindClass<T, PARENT> &addStaticFunction(const char *name, ARGS)
+    {
+        using CppProc = CppBindConstMethod<CppBindMethod<FN, ARGS>, FN, F>;
+        handle->Set(V8Key(name), functionTemplate<CppProc>(v8::Local<v8::Value>()));
+        return *this;
+    }
+
+#if V8_BIND_AUTO
+    template<auto F>
+    CppBindClass<T, PARENT> &addStaticFunction(const char *name)
+    {
+        return addStaticFunction<decltype(F), F>(name);
+    }
+
+    template<auto F, typename ARGS>
+    CppBindClass<T, PARENT> &addStaticFunction(const char *name, ARGS args)
+    {
+        return addStaticFunction<decltype(F), F>(name, args);
+    }
+#endif
+
+    /**
+     * Bind a static function that runs on the async thread pool (see V8ThreadPool) and returns a promise of its result.
+     * The promise is settled when the completion queue of the isolate is drained (see V8CompletionQueue).
+     */
+    template<typename FN>
+    CppBindClass<T, PARENT> &addAsyncFunction(const char *name, const FN &proc)
+    {
+        using CppProc = typename CppBindMethod<FN>::template Rebind<CppBindAsyncMethod>;
+        handle->Set(V8Key(name), functionTemplate<CppProc>(CppBindFunctionData(CppBindMethod<FN>::function(proc))));
+        return *this;
+    }
+
+    template<typename... FN>
+    CppBindClass<T, PARENT> &addStaticOverloads(const char *name, const FN &... procs)
+    {
+        using CppProc = CppBindOverload<CppBindMethod<FN>...>;
+        handle->Set(V8Key(name), functionTemplate<CppProc>(CppBindFunctionData(CppProc::functions(procs...))));
         return *this;
     }
 
+    /**
+     * Bind a scalar numeric function as a static element-wise function over TypedArrays (see CppBindVectorMethod).
+     * Bind it with V8_BIND_FN so the scalar function can be inlined into the loop.
+     */
+    template<typename FN>
+    CppBindClass<T, PARENT> &addVectorFunction(const char *name, const FN &proc)
+    {
+        using CppProc = typename CppBindMethod<FN>::template Rebind<CppBindVectorMethod>;
+        handle->Set(V8Key(name), functionTemplate<CppProc>(CppBindFunctionData(CppBindMethod<FN>::function(proc))));
+        return *this;
+    }
+
+    template<typename FN, FN F>
+    CppBindClass<T, PARENT> &addVectorFunction(const char *name)
+    {
+        using CppProc = CppBindConstMethod<typename CppBindMethod<FN>::template Rebind<CppBindVectorMethod>, FN, F>;
+        handle->Set(V8Key(name), functionTemplate<CppProc>(v8::Local<v8::Value>()));
+        return *this;
+    }
+
+#if V8_BIND_AUTO
+    template<auto F>
+    CppBindClass<T, PARENT> &addVectorFunction(const char *name)
+    {
+        return addVectorFunction<decltype(F), F>(name);
+    }
+#endif
+
     template<typename ARGS>
     CppBindClass<T, PARENT> &addConstructor(ARGS)
     {
@@ -497,7 +926,7 @@ public:
     CppBindClass<T, PARENT> &addFactory(const FN &proc)
     {
         using CppProc = CppBindMethod<FN, FN>;
-        handle->SetCallHandler(v8::Function::New(v8::Isolate::GetCurrent(), &CppProc::call, v8::External::New(v8::Isolate::GetCurrent(), CppProc::function(proc))));
+        handle->SetCallHandler(v8::Function::New(v8::Isolate::GetCurrent(), &CppProc::call, CppBindFunctionData(CppProc::function(proc))));
         return *this;
     }
 
@@ -505,7 +934,7 @@ public:
     CppBindClass<T, PARENT> &addFactory(const FN &proc, ARGS)
     {
         using CppProc = CppBindMethod<FN, ARGS>;
-        handle->SetCallHandler(v8::Function::New(v8::Isolate::GetCurrent(), &CppProc::call, v8::External::New(v8::Isolate::GetCurrent(), CppProc::function(proc))));
+        handle->SetCallHandler(v8::Function::New(v8::Isolate::GetCurrent(), &CppProc::call, CppBindFunctionData(CppProc::function(proc))));
         return *this;
     }
 
@@ -513,7 +942,7 @@ public:
     CppBindClass<T, PARENT> &addVariable(const char *name, V T::* v, bool writable = true)
     {
         v8::HandleScope scope(v8::Isolate::GetCurrent());
-        handle->PrototypeTemplate()->SetAccessor(V8Type<const char *>::set(name),
+        handle->PrototypeTemplate()->SetAccessor(V8Key(name),
                                                  &CppBindClassVariableGetter<T, V>::call,
                                                  writable ? &CppBindClassVariableSetter<T, V>::call : nullptr,
                                                  v8::External::New(v8::Isolate::GetCurrent(), v),
@@ -525,7 +954,7 @@ public:
     CppBindClass<T, PARENT> &addVariable(const char *name, const V T::* v)
     {
         v8::HandleScope scope(v8::Isolate::GetCurrent());
-        handle->PrototypeTemplate()->SetAccessor(V8Type<const char *>::set(name),
+        handle->PrototypeTemplate()->SetAccessor(V8Key(name),
                                                  &CppBindClassVariableGetter<T, V>::call,
                                                  nullptr,
                                                  v8::External::New(v8::Isolate::GetCurrent(), const_cast<V T::*>(v)),
@@ -538,7 +967,7 @@ public:
     addVariableRef(const char *name, V T::* v, bool writable = true)
     {
         v8::HandleScope scope(v8::Isolate::GetCurrent());
-        handle->PrototypeTemplate()->SetAccessor(V8Type<const char *>::set(name),
+        handle->PrototypeTemplate()->SetAccessor(V8Key(name),
                                                  &CppBindClassVariableGetter<T, V, V &>::call,
                                                  writable ? &CppBindClassVariableSetter<T, V>::call : nullptr,
                                                  v8::External::New(v8::Isolate::GetCurrent(), v),
@@ -551,7 +980,7 @@ public:
     addVariableRef(const char *name, V T::* v)
     {
         v8::HandleScope scope(v8::Isolate::GetCurrent());
-        handle->PrototypeTemplate()->SetAccessor(V8Type<const char *>::set(name),
+        handle->PrototypeTemplate()->SetAccessor(V8Key(name),
                                                  &CppBindClassVariableGetter<T, V, V &>::call,
                                                  nullptr,
                                                  v8::External::New(v8::Isolate::GetCurrent(), v),
@@ -563,7 +992,7 @@ public:
     CppBindClass<T, PARENT> &addVariableRef(const char *name, const V T::* v)
     {
         v8::HandleScope scope(v8::Isolate::GetCurrent());
-        handle->PrototypeTemplate()->SetAccessor(V8Type<const char *>::set(name),
+        handle->PrototypeTemplate()->SetAccessor(V8Key(name),
                                                  &CppBindClassVariableGetter<T, V, const V &>::call,
                                                  nullptr,
                                                  v8::External::New(v8::Isolate::GetCurrent(), const_cast<V T::*>(v)),
@@ -576,9 +1005,9 @@ public:
     {
         using CppGetter = CppBindClassMethod<T, FG, FG, CHK_GETTER>;
         using CppSetter = CppBindClassMethod<T, FS, FS, CHK_SETTER>;
-        handle->PrototypeTemplate()->SetAccessorProperty(V8Type<const char *>::set(name),
-                                                         v8::Function::New(v8::Isolate::GetCurrent(), &CppGetter::call, v8::External::New(v8::Isolate::GetCurrent(), CppGetter::function(get))),
-                                                         v8::Function::New(v8::Isolate::GetCurrent(), &CppSetter::call, v8::External::New(v8::Isolate::GetCurrent(), CppSetter::function(set))),
+        handle->PrototypeTemplate()->SetAccessorProperty(V8Key(name),
+                                                         functionTemplate<CppGetter>(CppBindFunctionData(CppGetter::function(get)), signature()),
+                                                         functionTemplate<CppSetter>(CppBindFunctionData(CppSetter::function(set)), signature()),
                                                          v8::ReadOnly);
         return *this;
     }
@@ -593,9 +1022,9 @@ public:
     CppBindClass<T, PARENT> &addPropertyReadOnly(const char *name, const FN &get)
     {
         using CppGetter = CppBindClassMethod<T, FN, FN, CHK_GETTER>;
-        handle->PrototypeTemplate()->SetAccessorProperty(V8Type<const char *>::set(name),
-                                                         v8::Function::New(v8::Isolate::GetCurrent(), &CppGetter::call, v8::External::New(v8::Isolate::GetCurrent(), CppGetter::function(get))),
-                                                         nullptr,
+        handle->PrototypeTemplate()->SetAccessorProperty(V8Key(name),
+                                                         functionTemplate<CppGetter>(CppBindFunctionData(CppGetter::function(get)), signature()),
+                                                         v8::Local<v8::FunctionTemplate>(),
                                                          v8::ReadOnly);
         return *this;
     }
@@ -604,8 +1033,8 @@ public:
     CppBindClass<T, PARENT> &addFunction(const char *name, const FN &proc)
     {
         using CppProc = CppBindClassMethod<T, FN>;
-        handle->PrototypeTemplate()->Set(V8Type<const char *>::set(name),
-                                         v8::Function::New(v8::Isolate::GetCurrent(), &CppProc::call, v8::External::New(v8::Isolate::GetCurrent(), CppProc::function(proc))),
+        handle->PrototypeTemplate()->Set(V8Key(name),
+                                         functionTemplate<CppProc>(CppBindFunctionData(CppProc::function(proc)), signature()),
                                          v8::ReadOnly);
         return *this;
     }
@@ -614,8 +1043,85 @@ public:
     CppBindClass<T, PARENT> &addFunction(const char *name, const FN &proc, ARGS)
     {
         using CppProc = CppBindClassMethod<T, FN, ARGS>;
-        handle->PrototypeTemplate()->Set(V8Type<const char *>::set(name),
-                                         v8::Function::New(v8::Isolate::GetCurrent(), &CppProc::call, v8::External::New(v8::Isolate::GetCurrent(), CppProc::function(proc))),
+        handle->PrototypeTemplate()->Set(V8Key(name),
+                                         functionTemplate<CppProc>(CppBindFunctionData(CppProc::function(proc)), signature()),
+                                         v8::ReadOnly);
+        return *this;
+    }
+
+    template<typename FN, FN F>
+    CppBindClass<T, PARENT> &addFunction(const char *name)
+    {
+        using CppProc = CppBindConstMethod<CppBindClassMethod<T, FN>, FN, F>;
+        handle->PrototypeTemplate()->Set(V8Key(name),
+                                         functionTemplate<CppProc>(v8::Local<v8::Value>(), signature()),
+                                         v8::ReadOnly);
+        return *this;
+    }
+
+    template<typename FN, FN F, typename ARGS>
+    CppBindClass<T, PARENT> &addFunction(const char *name, ARGS)
+    {
+        using CppProc = CppBindConstMethod<CppBindClassMethod<T, FN, ARGS>, FN, F>;
+        handle->PrototypeTemplate()->Set(V8Key(name),
+                                         functionTemplate<CppProc>(v8::Local<v8::Value>(), signature()),
+                                         v8::ReadOnly);
+        return *this;
+    }
+
+#if V8_BIND_AUTO
+    template<auto F>
+    CppBindClass<T, PARENT> &addFunction(const char *name)
+    {
+        return addFunction<decltype(F), F>(name);
+    }
+
+    template<auto F, typename ARGS>
+    CppBindClass<T, PARENT> &addFunction(const char *name, ARGS args)
+    {
+        return addFunction<decltype(F), F>(name, args);
+    }
+#endif
+
+    /**
+     * Bind a method together with a batch variant, reachable as Class.prototype.name.batch(objects, ...args).
+     * The batch variant calls the method on every object of the array in one native call
+     * and returns the results as an array (a TypedArray for numeric results).
+     */
+    template<typename FN>
+    CppBindClass<T, PARENT> &addBatchFunction(const char *name, const FN &proc)
+    {
+        using CppProc = CppBindClassMethod<T, FN>;
+        return addBatchFunction<CppProc>(name, CppBindFunctionData(CppProc::function(proc)));
+    }
+
+    template<typename FN, typename ARGS>
+    CppBindClass<T, PARENT> &addBatchFunction(const char *name, const FN &proc, ARGS)
+    {
+        using CppProc = CppBindClassMethod<T, FN, ARGS>;
+        return addBatchFunction<CppProc>(name, CppBindFunctionData(CppProc::function(proc)));
+    }
+
+    /**
+     * Bind a method that runs on the async thread pool and returns a promise of its result,
+     * the object must stay alive and must not be used from JS in a conflicting way until the promise is settled.
+     */
+    template<typename FN>
+    CppBindClass<T, PARENT> &addAsyncMethod(const char *name, const FN &proc)
+    {
+        using CppProc = typename CppBindClassMethod<T, FN>::template Rebind<CppBindAsyncClassMethod>;
+        handle->PrototypeTemplate()->Set(V8Key(name),
+                                         functionTemplate<CppProc>(CppBindFunctionData(CppBindClassMethod<T, FN>::function(proc)), signature()),
+                                         v8::ReadOnly);
+        return *this;
+    }
+
+    template<typename... FN>
+    CppBindClass<T, PARENT> &addOverloads(const char *name, const FN &... procs)
+    {
+        using CppProc = CppBindOverload<CppBindClassMethod<T, FN>...>;
+        handle->PrototypeTemplate()->Set(V8Key(name),
+                                         functionTemplate<CppProc>(CppBindFunctionData(CppProc::functions(procs...)), signature()),
                                          v8::ReadOnly);
         return *this;
     }
@@ -634,6 +1140,6 @@ public:
 
     PARENT endClass()
     {
-        return PARENT(handle->GetFunction()->Get(V8Type<const char *>::set("___parent")));
+        return PARENT(handle->GetFunction()->Get(V8_KEY("___parent")));
     }
 };
\ No newline at end of file
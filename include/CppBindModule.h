@@ -1,5 +1,8 @@
 #pragma once
 
+#include "CppBindClass.h"
+#include "V8Isolate.h"
+
 #include <v8.h>
 
 class CppBindModule
@@ -32,7 +35,7 @@ public:
     {
         v8::HandleScope scope(v8::Isolate::GetCurrent());
         v8::Local<v8::Object> moduleHandle;
-        auto key = V8Type<const char *>::set(name);
+        auto key = V8Key(name);
         if (handle->HasOwnProperty(key))
         {
             moduleHandle = handle->Get(key);
@@ -40,7 +43,7 @@ public:
         else
         {
             moduleHandle = v8::Object::New(v8::Isolate::GetCurrent());
-            moduleHandle->Set(V8Type<const char *>::set("___parent"), handle);
+            moduleHandle->Set(V8_KEY("___parent"), handle);
             handle->Set(key, moduleHandle);
         }
         return CppBindModule(moduleHandle);
@@ -48,13 +51,13 @@ public:
 
     CppBindModule endModule()
     {
-        return CppBindModule(handle->Get(V8Type<const char *>::set("___parent")));
+        return CppBindModule(handle->Get(V8_KEY("___parent")));
     }
 
     template<typename V>
     CppBindModule &addConstant(const char *name, const V &v)
     {
-        handle->Set(V8Type<const char *>::set(name), V8Type<V>::set(v), v8::ReadOnly);
+        handle->Set(V8Key(name), V8Type<V>::set(v), v8::ReadOnly);
         V8Ref r = V8Ref::fromValue(state(), v);
         if (r.isFunction())
         {
@@ -198,6 +201,32 @@ public:
         return *this;
     }
 
+    /**
+     * Add or replace a function that runs on the thread pool and returns a promise (see CppBindAsyncMethod).
+     */
+    template<typename FN>
+    CppBindModule &addAsyncFunction(const char *name, const FN &proc)
+    {
+        using CppProc = typename CppBindMethod<FN>::template Rebind<CppBindAsyncMethod>;
+        auto context = v8::Isolate::GetCurrent()->GetCurrentContext();
+        auto function = CppBindFunctionTemplate<CppProc>(CppBindFunctionData(CppBindMethod<FN>::function(proc)))->GetFunction(context).ToLocalChecked();
+        handle->Set(context, V8Key(name), function).FromJust();
+        return *this;
+    }
+
+    /**
+     * Add or replace the element-wise variant of a scalar numeric function (see CppBindVectorMethod).
+     */
+    template<typename FN>
+    CppBindModule &addVectorFunction(const char *name, const FN &proc)
+    {
+        using CppProc = typename CppBindMethod<FN>::template Rebind<CppBindVectorMethod>;
+        auto context = v8::Isolate::GetCurrent()->GetCurrentContext();
+        auto function = CppBindFunctionTemplate<CppProc>(CppBindFunctionData(CppBindMethod<FN>::function(proc)))->GetFunction(context).ToLocalChecked();
+        handle->Set(context, V8Key(name), function).FromJust();
+        return *this;
+    }
+
     /**
      * Add or replace a factory function.
      */
@@ -0,0 +1,458 @@
+#pragma once
+
+#include "CppArg.h"
+#include "CppFastCall.h"
+#include "CppObject.h"
+#include "V8Type.h"
+
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include <v8.h>
+
+/**
+ * Cheap check whether a JS value can be passed as argument type T, used to select an overload.
+ * rank orders the checks by specificity: when a value passes two checks, the higher rank is the
+ * narrower one (e.g. Int32 before Number). Bound classes also compare by inheritance, see ClassType.
+ * Types without a specific check accept any value and have the lowest rank.
+ */
+template<typename T, typename ENABLED = void>
+struct CppArgCheck
+{
+    static constexpr int rank = 0;
+
+    using ClassType = void;
+
+    static bool is(v8::Local<v8::Value>)
+    {
+        return true;
+    }
+};
+
+template<>
+struct CppArgCheck<bool>
+{
+    static constexpr int rank = 5;
+
+    using ClassType = void;
+
+    static bool is(v8::Local<v8::Value> value)
+    {
+        return value->IsBoolean();
+    }
+};
+
+template<typename T>
+struct CppArgCheck<T, typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value && !std::is_same<T, char>::value
+                                              && sizeof(T) <= sizeof(int32_t) && std::is_signed<T>::value>::type>
+{
+    static constexpr int rank = 3;
+
+    using ClassType = void;
+
+    static bool is(v8::Local<v8::Value> value)
+    {
+        return value->IsInt32();
+    }
+};
+
+template<typename T>
+struct CppArgCheck<T, typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value && !std::is_same<T, char>::value
+                                              && sizeof(T) <= sizeof(int32_t) && std::is_unsigned<T>::value>::type>
+{
+    static constexpr int rank = 3;
+
+    using ClassType = void;
+
+    static bool is(v8::Local<v8::Value> value)
+    {
+        return value->IsUint32();
+    }
+};
+
+template<typename T>
+struct CppArgCheck<T, typename std::enable_if<std::is_integral<T>::value && (sizeof(T) > sizeof(int32_t))>::type>
+{
+    static constexpr int rank = 2;
+
+    using ClassType = void;
+
+    static bool is(v8::Local<v8::Value> value)
+    {
+#if V8_HAS_BIGINT
+        return value->IsNumber() || value->IsBigInt();
+#else
+        return value->IsNumber();
+#endif
+    }
+};
+
+template<typename T>
+struct CppArgCheck<T, typename std::enable_if<std::is_floating_point<T>::value>::type>
+{
+    static constexpr int rank = 1;
+
+    using ClassType = void;
+
+    static bool is(v8::Local<v8::Value> value)
+    {
+        return value->IsNumber();
+    }
+};
+
+struct CppArgStringCheck
+{
+    static constexpr int rank = 5;
+
+    using ClassType = void;
+
+    static bool is(v8::Local<v8::Value> value)
+    {
+        return value->IsString();
+    }
+};
+
+template<>
+struct CppArgCheck<char> : CppArgStringCheck {};
+
+template<>
+struct CppArgCheck<const char *> : CppArgStringCheck {};
+
+template<>
+struct CppArgCheck<char *> : CppArgStringCheck {};
+
+template<>
+struct CppArgCheck<std::string> : CppArgStringCheck {};
+
+template<>
+struct CppArgCheck<std::u16string> : CppArgStringCheck {};
+
+template<>
+struct CppArgCheck<V8StringView> : CppArgStringCheck {};
+
+template<>
+struct CppArgCheck<V8ExternalString> : CppArgStringCheck {};
+
+template<typename T, typename A>
+struct CppArgCheck<std::vector<T, A>>
+{
+    static constexpr int rank = 4;
+
+    using ClassType = void;
+
+    static bool is(v8::Local<v8::Value> value)
+    {
+        return value->IsArray() || value->IsTypedArray();
+    }
+};
+
+template<typename T>
+struct CppArgCheck<V8Span<T>>
+{
+    static constexpr int rank = 4;
+
+    using ClassType = void;
+
+    static bool is(v8::Local<v8::Value> value)
+    {
+        return value->IsArrayBufferView() || value->IsArrayBuffer();
+    }
+};
+
+/**
+ * Bound classes are checked against the type of the wrapped object, so overloads can differ by class type.
+ */
+template<typename T>
+struct CppArgCheck<T, typename std::enable_if<std::is_class<T>::value && !V8TypeMappingExists<T>::value>::type>
+{
+    static constexpr int rank = 5;
+
+    using ClassType = typename CppObjectTraits<T>::ObjectType;
+
+    static bool is(v8::Local<v8::Value> value)
+    {
+        return value->IsObject() && CppObject::cast<ClassType>(value.As<v8::Object>()) != nullptr;
+    }
+};
+
+template<typename T>
+struct CppArgCheck<T *, typename std::enable_if<std::is_class<T>::value>::type>
+{
+    static constexpr int rank = 5;
+
+    using ClassType = typename std::remove_cv<T>::type;
+
+    static bool is(v8::Local<v8::Value> value)
+    {
+        return value->IsObject() && CppObject::cast<ClassType>(value.As<v8::Object>()) != nullptr;
+    }
+};
+
+template<typename T>
+struct CppArgSpecCheck
+{
+    using Traits = CppArgTraits<T>;
+    using Check = CppArgCheck<typename std::decay<typename Traits::Type>::type>;
+
+    static constexpr bool isRequired = Traits::isInput && !Traits::isOptional;
+
+    static constexpr int rank = Traits::isInput ? Check::rank : 0;
+
+    using ClassType = typename std::conditional<Traits::isInput, typename Check::ClassType, void>::type;
+
+    static bool is(v8::Local<v8::Value> value)
+    {
+        return !Traits::isInput
+            || (Traits::isOptional && value->IsUndefined())
+            || Check::is(value);
+    }
+};
+
+template<int... INDEX>
+struct CppIndexList {};
+
+template<int N, int... INDEX>
+struct CppIndexSequence
+    : CppIndexSequence<N - 1, N - 1, INDEX...> {};
+
+template<int... INDEX>
+struct CppIndexSequence<0, INDEX...>
+{
+    using Type = CppIndexList<INDEX...>;
+};
+
+template<typename... P>
+struct CppArgTupleCheck;
+
+template<>
+struct CppArgTupleCheck<>
+{
+    static constexpr int required = 0;
+
+    static bool is(const v8::FunctionCallbackInfo<v8::Value> &, int)
+    {
+        return true;
+    }
+};
+
+template<typename P0, typename... P>
+struct CppArgTupleCheck<P0, P...>
+{
+    static constexpr int required = CppArgTupleCheck<P...>::required > 0 ? CppArgTupleCheck<P...>::required + 1 : (CppArgSpecCheck<P0>::isRequired ? 1 : 0);
+
+    static bool is(const v8::FunctionCallbackInfo<v8::Value> &args, int index)
+    {
+        return CppArgSpecCheck<P0>::is(args[index]) && CppArgTupleCheck<P...>::is(args, index + 1);
+    }
+};
+
+/**
+ * Whether the call arguments fit an argument list: the argument count must be in range
+ * and every argument must pass its type check.
+ */
+template<typename... P>
+struct CppArgMatch
+{
+    static bool is(const v8::FunctionCallbackInfo<v8::Value> &args)
+    {
+        auto count = args.Length();
+        return count >= CppArgTupleCheck<P...>::required
+            && count <= static_cast<int>(sizeof...(P))
+            && CppArgTupleCheck<P...>::is(args, 0);
+    }
+};
+
+/**
+ * Whether argument spec A is narrower than B: a higher check rank, or a bound class derived from B.
+ */
+template<typename A, typename B>
+struct CppArgNarrower
+{
+    using ClassA = typename CppArgSpecCheck<A>::ClassType;
+    using ClassB = typename CppArgSpecCheck<B>::ClassType;
+
+    static constexpr bool value = CppArgSpecCheck<A>::rank > CppArgSpecCheck<B>::rank
+        || (!std::is_void<ClassA>::value && !std::is_void<ClassB>::value
+            && !std::is_same<ClassA, ClassB>::value && std::is_base_of<ClassB, ClassA>::value);
+};
+
+/**
+ * Compare two argument lists position by position: narrower is set when A is narrower somewhere,
+ * wider when B is narrower somewhere. Extra arguments of the longer list are not compared.
+ */
+template<typename A, typename B>
+struct CppArgCompare
+{
+    static constexpr bool narrower = false;
+    static constexpr bool wider = false;
+};
+
+template<typename A0, typename... A, typename B0, typename... B>
+struct CppArgCompare<CppArgMatch<A0, A...>, CppArgMatch<B0, B...>>
+{
+    using Next = CppArgCompare<CppArgMatch<A...>, CppArgMatch<B...>>;
+
+    static constexpr bool narrower = CppArgNarrower<A0, B0>::value || Next::narrower;
+    static constexpr bool wider = CppArgNarrower<B0, A0>::value || Next::wider;
+};
+
+/**
+ * Overload A is more specific than B when its arguments are nowhere wider and somewhere narrower.
+ */
+template<typename A, typename B>
+struct CppOverloadBefore
+{
+    using Compare = CppArgCompare<typename A::Proc::Arguments, typename B::Proc::Arguments>;
+
+    static constexpr bool value = Compare::narrower && !Compare::wider;
+};
+
+template<int INDEX, typename PROC>
+struct CppOverloadEntry
+{
+    static constexpr int index = INDEX;
+
+    using Proc = PROC;
+};
+
+template<typename... E>
+struct CppOverloadList {};
+
+template<typename E, typename LIST>
+struct CppOverloadInsert;
+
+template<typename E>
+struct CppOverloadInsert<E, CppOverloadList<>>
+{
+    using Type = CppOverloadList<E>;
+};
+
+template<typename E, typename L0, typename... L>
+struct CppOverloadInsert<E, CppOverloadList<L0, L...>>
+{
+    template<typename LIST>
+    struct Prepend;
+
+    template<typename... R>
+    struct Prepend<CppOverloadList<R...>>
+    {
+        using Type = CppOverloadList<L0, R...>;
+    };
+
+    using Type = typename std::conditional<CppOverloadBefore<E, L0>::value,
+        CppOverloadList<E, L0, L...>,
+        typename Prepend<typename CppOverloadInsert<E, CppOverloadList<L...>>::Type>::Type>::type;
+};
+
+/**
+ * Order the overloads at compile time so every overload comes before the ones it is more specific than,
+ * overloads that are not comparable keep their declaration order.
+ */
+template<typename SORTED, typename... E>
+struct CppOverloadSort
+{
+    using Type = SORTED;
+};
+
+template<typename SORTED, typename E0, typename... E>
+struct CppOverloadSort<SORTED, E0, E...>
+    : CppOverloadSort<typename CppOverloadInsert<E0, SORTED>::Type, E...> {};
+
+template<typename SEQ, typename... PROC>
+struct CppOverloadEntries;
+
+template<int... INDEX, typename... PROC>
+struct CppOverloadEntries<CppIndexList<INDEX...>, PROC...>
+    : CppOverloadSort<CppOverloadList<>, CppOverloadEntry<INDEX, PROC>...> {};
+
+/**
+ * Whether an overload after the matching one FIRST also matches without FIRST being more specific,
+ * the overloads FIRST is more specific than are skipped at compile time.
+ */
+template<typename FIRST, typename LIST>
+struct CppOverloadAmbiguous;
+
+template<typename FIRST>
+struct CppOverloadAmbiguous<FIRST, CppOverloadList<>>
+{
+    static bool is(const v8::FunctionCallbackInfo<v8::Value> &)
+    {
+        return false;
+    }
+};
+
+template<typename FIRST, typename E0, typename... E>
+struct CppOverloadAmbiguous<FIRST, CppOverloadList<E0, E...>>
+{
+    static bool is(const v8::FunctionCallbackInfo<v8::Value> &v8Args)
+    {
+        return (!CppOverloadBefore<FIRST, E0>::value && E0::Proc::match(v8Args))
+            || CppOverloadAmbiguous<FIRST, CppOverloadList<E...>>::is(v8Args);
+    }
+};
+
+template<typename LIST>
+struct CppBindOverloadDispatch;
+
+template<>
+struct CppBindOverloadDispatch<CppOverloadList<>>
+{
+    template<typename FNS>
+    static void call(const FNS &, const v8::FunctionCallbackInfo<v8::Value> &)
+    {
+        v8::Isolate::GetCurrent()->ThrowException(v8::Exception::TypeError(v8::String::NewFromUtf8(v8::Isolate::GetCurrent(), "except arguments of one of the overloads", v8::NewStringType::kNormal).ToLocalChecked()));
+    }
+};
+
+template<typename E0, typename... E>
+struct CppBindOverloadDispatch<CppOverloadList<E0, E...>>
+{
+    template<typename FNS>
+    static void call(const FNS &fns, const v8::FunctionCallbackInfo<v8::Value> &v8Args)
+    {
+        if (!E0::Proc::match(v8Args))
+        {
+            CppBindOverloadDispatch<CppOverloadList<E...>>::call(fns, v8Args);
+        }
+        else if (CppOverloadAmbiguous<E0, CppOverloadList<E...>>::is(v8Args))
+        {
+            v8::Isolate::GetCurrent()->ThrowException(v8::Exception::TypeError(v8::String::NewFromUtf8(v8::Isolate::GetCurrent(), "ambiguous call of overloaded function", v8::NewStringType::kNormal).ToLocalChecked()));
+        }
+        else
+        {
+            E0::Proc::invoke(std::get<E0::index>(fns), v8Args);
+        }
+    }
+};
+
+/**
+ * One native callback for several bound functions under the same name. The overloads are sorted at compile time
+ * by specificity (e.g. int before double, a derived class before its base), and the first one whose argument checks
+ * pass is called. If a less specific overload that is not comparable also passes, the call is ambiguous and throws,
+ * as does a call matching no overload. The checks are unrolled at compile time, so a call costs one native crossing
+ * and a few type tests.
+ */
+template<typename... PROC>
+struct CppBindOverload
+{
+    using Functions = std::tuple<typename PROC::FunctionType...>;
+
+    using Entries = typename CppOverloadEntries<typename CppIndexSequence<sizeof...(PROC)>::Type, PROC...>::Type;
+
+    using Fast = CppFastMethodImpl<false, void, void>;
+
+    static void call(const v8::FunctionCallbackInfo<v8::Value> &v8Args)
+    {
+        auto fns = static_cast<const Functions *>(v8Args.Data().As<v8::External>()->Value());
+        assert(fns);
+        CppBindOverloadDispatch<Entries>::call(*fns, v8Args);
+    }
+
+    template<typename... FN>
+    static Functions functions(const FN &... procs)
+    {
+        return Functions(PROC::function(procs)...);
+    }
+};
@@ -0,0 +1,232 @@
+#pragma once
+
+#include "CppObject.h"
+
+#include <cstdint>
+#include <type_traits>
+
+#include <v8.h>
+
+/**
+ * V8 fast API calls let optimized code call a plain C function directly instead of going through
+ * the FunctionCallbackInfo callback. The binding generates that C function for every bound function
+ * whose arguments and return value are all primitives, the slow callback is still registered and used
+ * by the interpreter and whenever the arguments do not fit the fast signature.
+ * Requires the FastApiCallbackOptions data handle and fallback flag (V8 11) and the v8-fast-api-calls.h header,
+ * which not every embedder ships. Define V8_BINDING_FAST_API to 0 to disable it for the whole build,
+ * or call setFastCalls(false) on a class binding to register the following functions without it.
+ */
+#ifndef V8_BINDING_FAST_API
+#if defined(__has_include)
+#if __has_include(<v8-fast-api-calls.h>)
+#define V8_BINDING_FAST_API (V8_MAJOR_VERSION == 11)
+#endif
+#endif
+#endif
+
+#ifndef V8_BINDING_FAST_API
+#define V8_BINDING_FAST_API 0
+#endif
+
+#if V8_BINDING_FAST_API
+#include <v8-fast-api-calls.h>
+#endif
+
+/**
+ * C type passed by the fast API for a bound argument type. Only types that convert
+ * the same way on both paths are listed, anything else (strings, objects, 64-bit integers,
+ * optional or output argument specs) makes the whole function use the slow callback only.
+ */
+template<typename T>
+struct CppFastType
+{
+    static constexpr bool value = false;
+    using CType = T;
+};
+
+#define V8_FAST_TYPE(T, C) \
+    template<> \
+    struct CppFastType<T> \
+    { \
+        static constexpr bool value = true; \
+        using CType = C; \
+    };
+
+V8_FAST_TYPE(bool, bool)
+V8_FAST_TYPE(signed char, int32_t)
+V8_FAST_TYPE(short, int32_t)
+V8_FAST_TYPE(int, int32_t)
+V8_FAST_TYPE(unsigned char, uint32_t)
+V8_FAST_TYPE(unsigned short, uint32_t)
+V8_FAST_TYPE(unsigned int, uint32_t)
+V8_FAST_TYPE(float, float)
+V8_FAST_TYPE(double, double)
+
+#undef V8_FAST_TYPE
+
+template<typename T>
+struct CppFastType<const T>
+    : CppFastType<T> {};
+
+template<typename T>
+struct CppFastType<const T &>
+    : CppFastType<T> {};
+
+template<typename R>
+struct CppFastReturn
+    : CppFastType<R> {};
+
+template<>
+struct CppFastReturn<void>
+{
+    static constexpr bool value = true;
+    using CType = void;
+};
+
+template<typename... P>
+struct CppFastArgs;
+
+template<>
+struct CppFastArgs<>
+{
+    static constexpr bool value = true;
+};
+
+template<typename P0, typename... P>
+struct CppFastArgs<P0, P...>
+{
+    static constexpr bool value = CppFastType<P0>::value && CppFastArgs<P...>::value;
+};
+
+template<bool IS_PROXY>
+struct CppFastInvoke;
+
+template<>
+struct CppFastInvoke<false>
+{
+    template<typename R, typename T, typename FN, typename... A>
+    static R call(T *t, const FN &func, A... args)
+    {
+        return (t->*func)(args...);
+    }
+};
+
+template<>
+struct CppFastInvoke<true>
+{
+    template<typename R, typename T, typename FN, typename... A>
+    static R call(T *t, const FN &func, A... args)
+    {
+        return func(t, args...);
+    }
+};
+
+/**
+ * Where the fast function gets the bound function from: the function template data,
+ * or a function pointer fixed at compile time (see CppBindConstMethod).
+ */
+template<typename FN>
+struct CppFastDataFunction
+{
+#if V8_BINDING_FAST_API
+    static const FN &get(const v8::FastApiCallbackOptions &options)
+    {
+        return *static_cast<const FN *>(options.data.As<v8::External>()->Value());
+    }
+#endif
+};
+
+template<typename TARGET, typename FN, FN F>
+struct CppFastConstFunction
+{
+#if V8_BINDING_FAST_API
+    static TARGET get(const v8::FastApiCallbackOptions &)
+    {
+        return static_cast<TARGET>(F);
+    }
+#endif
+};
+
+template<bool ENABLED, typename SOURCE, typename R, typename... P>
+struct CppFastMethodImpl
+{
+    static constexpr bool value = false;
+
+#if V8_BINDING_FAST_API
+    static const v8::CFunction *function()
+    {
+        return nullptr;
+    }
+#endif
+};
+
+template<bool ENABLED, typename T, bool IS_PROXY, typename SOURCE, typename R, typename... P>
+struct CppFastClassMethodImpl
+{
+    static constexpr bool value = false;
+
+#if V8_BINDING_FAST_API
+    static const v8::CFunction *function()
+    {
+        return nullptr;
+    }
+#endif
+};
+
+#if V8_BINDING_FAST_API
+
+template<typename SOURCE, typename R, typename... P>
+struct CppFastMethodImpl<true, SOURCE, R, P...>
+{
+    static constexpr bool value = true;
+
+    static typename CppFastReturn<R>::CType call(v8::Local<v8::Object>, typename CppFastType<P>::CType... args, v8::FastApiCallbackOptions &options)
+    {
+        return static_cast<typename CppFastReturn<R>::CType>(SOURCE::get(options)(args...));
+    }
+
+    static const v8::CFunction *function()
+    {
+        static const v8::CFunction cfunction = v8::CFunction::Make(&call);
+        return &cfunction;
+    }
+};
+
+/**
+ * The receiver goes through the same type check as the slow path (CppObject::cast), the function
+ * template signature alone does not prove that an internal field holds a wrapped T.
+ * A receiver without a wrapped object of the right type (e.g. a prototype, or an instance created
+ * without the constructor) falls back to the slow callback, which throws the usual TypeError.
+ */
+template<typename T, bool IS_PROXY, typename SOURCE, typename R, typename... P>
+struct CppFastClassMethodImpl<true, T, IS_PROXY, SOURCE, R, P...>
+{
+    static constexpr bool value = true;
+
+    static typename CppFastReturn<R>::CType call(v8::Local<v8::Object> receiver, typename CppFastType<P>::CType... args, v8::FastApiCallbackOptions &options)
+    {
+        T *obj = CppObject::cast<T>(receiver);
+        if (obj == nullptr)
+        {
+            options.fallback = true;
+            return typename CppFastReturn<R>::CType();
+        }
+        return static_cast<typename CppFastReturn<R>::CType>(CppFastInvoke<IS_PROXY>::template call<R>(obj, SOURCE::get(options), args...));
+    }
+
+    static const v8::CFunction *function()
+    {
+        static const v8::CFunction cfunction = v8::CFunction::Make(&call);
+        return &cfunction;
+    }
+};
+
+#endif
+
+template<typename SOURCE, typename R, typename... P>
+struct CppFastMethod
+    : CppFastMethodImpl<V8_BINDING_FAST_API && CppFastReturn<R>::value && CppFastArgs<P...>::value, SOURCE, R, P...> {};
+
+template<typename T, bool IS_PROXY, typename SOURCE, typename R, typename... P>
+struct CppFastClassMethod
+    : CppFastClassMethodImpl<V8_BINDING_FAST_API && CppFastReturn<R>::value && CppFastArgs<P...>::value, T, IS_PROXY, SOURCE, R, P...> {};
@@ -51,17 +51,16 @@ struct CppDispatchMethod<FN, R, TUPLE, 0, INDEX...>
 template<typename FN, typename R, typename... P>
 struct CppInvokeMethod
 {
-    static v8::Local<v8::Value> call(const FN &func, std::tuple<P...> &args)
+    static void call(const FN &func, std::tuple<P...> &args, v8::ReturnValue<v8::Value> ret)
     {
-        v8::EscapableHandleScope scope(v8::Isolate::GetCurrent());
-        return scope.Escape(CppDispatchMethod<FN, R, std::tuple<P...>, sizeof...(P)>::call(func, args));
+        V8ReturnValue<R>::set(ret, CppDispatchMethod<FN, R, std::tuple<P...>, sizeof...(P)>::call(func, args));
     }
 };
 
 template<typename FN, typename... P>
 struct CppInvokeMethod<FN, void, P...>
 {
-    static void call(const FN &func, std::tuple<P...> &args)
+    static void call(const FN &func, std::tuple<P...> &args, v8::ReturnValue<v8::Value>)
     {
         CppDispatchMethod<FN, void, std::tuple<P...>, sizeof...(P)>::call(func, args);
     }
@@ -126,17 +125,53 @@ struct CppDispatchClassMethod<T, true, FN, R, TUPLE, 0, INDEX...>
 template<typename T, bool IS_PROXY, typename FN, typename R, typename... P>
 struct CppInvokeClassMethod
 {
-    static v8::Local<v8::Value> call(T *t, const FN &func, std::tuple<P...> &args)
+    static void call(T *t, const FN &func, std::tuple<P...> &args, v8::ReturnValue<v8::Value> ret)
     {
-        return V8Type<R>::set(CppDispatchClassMethod<T, IS_PROXY, FN, R, std::tuple<P...>, sizeof...(P)>::call(t, func, args));
+        V8ReturnValue<R>::set(ret, CppDispatchClassMethod<T, IS_PROXY, FN, R, std::tuple<P...>, sizeof...(P)>::call(t, func, args));
     }
 };
 
 template<typename T, bool IS_PROXY, typename FN, typename... P>
 struct CppInvokeClassMethod<T, IS_PROXY, FN, void, P...>
 {
-    static void call(T *t, const FN &func, std::tuple<P...> &args)
+    static void call(T *t, const FN &func, std::tuple<P...> &args, v8::ReturnValue<v8::Value>)
     {
         CppDispatchClassMethod<T, IS_PROXY, FN, void, std::tuple<P...>, sizeof...(P)>::call(t, func, args);
     }
-};
\ No newline at end of file
+};
+
+/**
+ * Element-wise loop of a vector function. When every argument is an array the elements are
+ * read contiguously, so an inlined scalar function can be auto-vectorized by the compiler.
+ */
+template<typename FN, typename R, typename TUPLE, size_t N, size_t... INDEX>
+struct CppDispatchVector
+    : CppDispatchVector<FN, R, TUPLE, N - 1, N - 1, INDEX...> {};
+
+template<typename FN, typename R, typename TUPLE, size_t... INDEX>
+struct CppDispatchVector<FN, R, TUPLE, 0, INDEX...>
+{
+    static void call(const FN &func, const TUPLE &args, R *out, size_t size)
+    {
+        bool contiguous = true;
+        bool strides[] = { true, (std::get<INDEX>(args).stride == 1)... };
+        for (auto stride : strides)
+        {
+            contiguous = contiguous && stride;
+        }
+        if (contiguous)
+        {
+            for (size_t i = 0; i < size; ++i)
+            {
+                out[i] = static_cast<R>(func(std::get<INDEX>(args).data[i]...));
+            }
+        }
+        else
+        {
+            for (size_t i = 0; i < size; ++i)
+            {
+                out[i] = static_cast<R>(func(std::get<INDEX>(args)[i]...));
+            }
+        }
+    }
+};
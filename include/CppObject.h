@@ -1,43 +1,209 @@
 #pragma once
 
 #include "CppInvoke.h"
+#include "V8Isolate.h"
 
 #include <cassert>
+#include <cstddef>
 #include <cstdint>
+#include <new>
 #include <type_traits>
 #include <tuple>
+#include <utility>
+#include <vector>
 
 #include <v8.h>
 
+/**
+ * Runtime type of a wrapped object, one instance per C++ type. A class registered with a super class
+ * copies the ancestry of the super class and appends itself, so checking whether an object is a T
+ * (or derived from T) is a single lookup at the depth of T in the ancestry of the object type.
+ * Each ancestor also records the offset of its subobject, so upcasts work for bases not at offset 0.
+ * Virtual base classes are not supported.
+ */
+class CppTypeInfo
+{
+public:
+    CppTypeInfo(const CppTypeInfo &) = delete;
+
+    CppTypeInfo &operator=(const CppTypeInfo &) = delete;
+
+    template<typename T>
+    static CppTypeInfo &get()
+    {
+        static CppTypeInfo info;
+        return info;
+    }
+
+    size_t depth() const
+    {
+        return ancestors.size() - 1;
+    }
+
+    bool isA(const CppTypeInfo &base) const
+    {
+        return base.depth() < ancestors.size() && ancestors[base.depth()] == &base;
+    }
+
+    /** Convert a pointer to an object of this type to its base subobject, base must be an ancestor */
+    void *upcast(void *ptr, const CppTypeInfo &base) const
+    {
+        return static_cast<char *>(ptr) + offsets[base.depth()];
+    }
+
+    template<typename T, typename SUPER>
+    void extend()
+    {
+        static_assert(std::is_base_of<SUPER, T>::value, "except super class to be a base of the class");
+        auto &super = get<SUPER>();
+        auto derived = reinterpret_cast<T *>(alignof(T) * 4096);
+        auto offset = reinterpret_cast<char *>(static_cast<SUPER *>(derived)) - reinterpret_cast<char *>(derived);
+        ancestors = super.ancestors;
+        ancestors.push_back(this);
+        offsets.clear();
+        for (auto superOffset : super.offsets)
+        {
+            offsets.push_back(offset + superOffset);
+        }
+        offsets.push_back(0);
+    }
+
+private:
+    CppTypeInfo() : ancestors(1, this), offsets(1, 0) {}
+
+    std::vector<const CppTypeInfo *> ancestors;
+    std::vector<ptrdiff_t> offsets;
+};
+
+/**
+ * Allocation policy of the wrapped object holders (CppObjectValue, CppObjectPtr, CppObjectSharedPtr).
+ * By default holders that fit a size class are taken from the slab pool of the isolate (see V8SlabPool),
+ * larger or over-aligned ones from the heap. Specialize CppObjectAllocator for a holder type to change
+ * its policy, or define V8_BINDING_OBJECT_HEAP to 1 to allocate every holder on the heap.
+ */
+#ifndef V8_BINDING_OBJECT_HEAP
+#define V8_BINDING_OBJECT_HEAP 0
+#endif
+
+struct CppObjectHeapAllocator
+{
+    static void *allocate(v8::Isolate *, size_t size)
+    {
+        return ::operator new(size);
+    }
+
+    static void deallocate(v8::Isolate *, void *ptr, size_t)
+    {
+        ::operator delete(ptr);
+    }
+};
+
+struct CppObjectSlabAllocator
+{
+    static void *allocate(v8::Isolate *isolate, size_t size)
+    {
+        return V8IsolateData::get(isolate).slabs.allocate(size);
+    }
+
+    /**
+     * Looks the isolate data up without creating it, as this may run from a GC callback. Every holder
+     * is released by handles.dispose before the pool goes away, so the data is always there; if it is not,
+     * the block belonged to chunks already freed with the pool and there is nothing left to free.
+     */
+    static void deallocate(v8::Isolate *isolate, void *ptr, size_t size)
+    {
+        auto data = static_cast<V8IsolateData *>(isolate->GetData(V8_BINDING_ISOLATE_SLOT));
+        assert(data != nullptr && "slab holder released after the isolate data was disposed");
+        if (data != nullptr)
+        {
+            data->slabs.deallocate(ptr, size);
+        }
+    }
+};
+
 template<typename T>
-struct CppClassPersistent
+struct CppObjectAllocator
+    : std::conditional<!V8_BINDING_OBJECT_HEAP && V8SlabPool::fits(sizeof(T), alignof(T)), CppObjectSlabAllocator, CppObjectHeapAllocator>::type {};
+
+/**
+ * Estimated external memory held by a wrapped object, reported to V8 so the GC sees the real cost
+ * of wrappers owning large buffers. The default is sizeof(T), or the result of a
+ * size_t externalSize() const member when T has one; specialize V8ExternalSize<T> for other types.
+ * When the size of a live object changes, call CppObject::updateExternalSize to report it again.
+ */
+template<typename T, typename ENABLED = void>
+struct V8ExternalSize
 {
-    static v8::UniquePersistent<v8::FunctionTemplate> persistent;
+    static size_t of(const T &)
+    {
+        return sizeof(T);
+    }
 };
 
+template<typename T>
+struct V8ExternalSize<T, typename std::enable_if<std::is_convertible<decltype(std::declval<const T &>().externalSize()), size_t>::value>::type>
+{
+    static size_t of(const T &obj)
+    {
+        return obj.externalSize();
+    }
+};
+
+template<typename T>
+struct CppObjectWrapper;
+
 class CppObject
 {
 protected:
     CppObject() {}
 
     template<typename T>
-    static T *allocate(v8::Local<v8::Object> self)
+    static T *allocate(v8::Local<v8::Object> self, const CppTypeInfo &type)
     {
         assert(self->InternalFieldCount() == 1);
-        auto instance = new T;
+        auto instance = ::new(CppObjectAllocator<T>::allocate(v8::Isolate::GetCurrent(), sizeof(T))) T;
+        instance->type = &type;
         self->SetAlignedPointerInInternalField(0, instance);
-        v8::Isolate::GetCurrent()->AdjustAmountOfExternalAllocatedMemory(static_cast<int64_t>(sizeof(T)));
-        persistent.Reset(v8::Isolate::GetCurrent(), self);
-        persistent.SetWeak(instance, &deallocate, v8::WeakCallbackType::kParameter);
+        auto &handles = V8IsolateData::get(v8::Isolate::GetCurrent()).handles;
+        instance->slot = handles.acquire(instance, &release<T>);
+        auto &handle = handles.handle(instance->slot);
+        handle.Reset(v8::Isolate::GetCurrent(), self);
+        handle.SetWeak(instance, &deallocate, v8::WeakCallbackType::kParameter);
         return instance;
     }
 
+    /** Weak callback, reads the isolate data slot directly so a GC never creates the isolate data */
     template<typename T>
     static void deallocate(const v8::WeakCallbackInfo<T> &data)
     {
-        delete data.GetParameter();
-        v8::Isolate::GetCurrent()->AdjustAmountOfExternalAllocatedMemory(static_cast<int64_t>(-sizeof(T)));
-        persistent.Reset();
+        auto instance = data.GetParameter();
+        auto isolateData = static_cast<V8IsolateData *>(data.GetIsolate()->GetData(V8_BINDING_ISOLATE_SLOT));
+        if (isolateData != nullptr)
+        {
+            isolateData->handles.release(instance->slot);
+        }
+        release<T>(data.GetIsolate(), instance);
+    }
+
+    template<typename T>
+    static void release(v8::Isolate *isolate, void *ptr)
+    {
+        auto instance = static_cast<T *>(ptr);
+        V8ExternalMemory::adjust(isolate, -static_cast<int64_t>(instance->reported));
+        instance->~T();
+        CppObjectAllocator<T>::deallocate(isolate, instance, sizeof(T));
+    }
+
+    /** Report the external size of the holder, or its change since the last report */
+    void account(v8::Isolate *isolate)
+    {
+        if (slot == V8HandleTable::NONE)
+        {
+            return;
+        }
+        auto size = measure();
+        V8ExternalMemory::adjust(isolate, static_cast<int64_t>(size) - static_cast<int64_t>(reported));
+        reported = size;
     }
 
 public:
@@ -54,6 +220,40 @@ public:
 
     virtual void *objectPtr() = 0;
 
+    /** External memory of the holder and the object it owns */
+    virtual size_t measure() = 0;
+
+    /** Measure the object wrapped by a JS object again and report its size change */
+    static void updateExternalSize(v8::Local<v8::Object> self)
+    {
+        if (self->InternalFieldCount() > 0)
+        {
+            auto object = static_cast<CppObject *>(self->GetAlignedPointerFromInternalField(0));
+            if (object != nullptr)
+            {
+                object->account(v8::Isolate::GetCurrent());
+            }
+        }
+    }
+
+    /** Same through the wrapper cache, for C++ code that only has the object (classes with V8IdentityCache) */
+    template<typename T>
+    static void updateExternalSize(const T *obj)
+    {
+        auto isolate = v8::Isolate::GetCurrent();
+        v8::HandleScope scope(isolate);
+        auto self = CppObjectWrapper<T>::find(isolate, obj);
+        if (!self.IsEmpty())
+        {
+            updateExternalSize(self);
+        }
+    }
+
+    const CppTypeInfo &typeInfo() const
+    {
+        return *type;
+    }
+
     template<typename T>
     static CppObject *getExactObject(v8::Local<v8::Object> self)
     {
@@ -70,25 +270,32 @@ public:
     static T *cast(v8::Local<v8::Object> self)
     {
         CppObject *object = getObject<T>(self, false, false);
-        return object ? static_cast<T *>(object->objectPtr()) : nullptr;
+        return object ? object->template objectAs<T>() : nullptr;
     }
 
     template<typename T>
     static T *get(v8::Local<v8::Object> self)
     {
-        return static_cast<T *>(getObject<T>(self)->objectPtr());
+        CppObject *object = getObject<T>(self);
+        return object ? object->template objectAs<T>() : nullptr;
+    }
+
+    /** The wrapped object as a T, which must be its type or one of its registered ancestors */
+    template<typename T>
+    T *objectAs()
+    {
+        return static_cast<T *>(type->upcast(objectPtr(), CppTypeInfo::get<typename std::remove_cv<T>::type>()));
     }
 
 private:
     template<typename T>
     static CppObject *getObject(v8::Local<v8::Object> self, bool is_exact, bool raise_error)
     {
-        v8::HandleScope scope(v8::Isolate::GetCurrent());
         if (self == v8::Undefined(v8::Isolate::GetCurrent()) || self->InternalFieldCount() <= 0)
         {
             if (raise_error)
             {
-                v8::Isolate::GetCurrent()->ThrowException(v8::Exception::TypeError(v8::String::NewFromUtf8(v8::Isolate::GetCurrent(), "except cpp class, but empty")));
+                v8::Isolate::GetCurrent()->ThrowException(v8::Exception::TypeError(v8::String::NewFromUtf8(v8::Isolate::GetCurrent(), "except cpp class, but empty", v8::NewStringType::kNormal).ToLocalChecked()));
             }
             return nullptr;
         }
@@ -98,48 +305,34 @@ private:
         {
             if (raise_error)
             {
-                v8::Isolate::GetCurrent()->ThrowException(v8::Exception::TypeError(v8::String::NewFromUtf8(v8::Isolate::GetCurrent(), "except cpp class, but got NULL")));
+                v8::Isolate::GetCurrent()->ThrowException(v8::Exception::TypeError(v8::String::NewFromUtf8(v8::Isolate::GetCurrent(), "except cpp class, but got NULL", v8::NewStringType::kNormal).ToLocalChecked()));
             }
             return nullptr;
         }
-        auto &persistent = CppClassPersistent<T>::persistent;
-        auto prototype = self->GetPrototype();
-        while (true)
+        auto &type = CppTypeInfo::get<typename std::remove_cv<T>::type>();
+        if (is_exact ? object->type != &type : !object->type->isA(type))
         {
-            if (prototype == persistent)
-            {
-                break;
-            }
-            if (is_exact)
-            {
-                if (raise_error)
-                {
-                    v8::Isolate::GetCurrent()->ThrowException(v8::Exception::TypeError(v8::String::NewFromUtf8(v8::Isolate::GetCurrent(), "except cpp class, but wrong type")));
-                }
-                return nullptr;
-            }
-            if (prototype->IsObject())
-            {
-                prototype = prototype->ToObject()->GetPrototype();
-            }
-            else
+            if (raise_error)
             {
-                if (raise_error)
-                {
-                    v8::Isolate::GetCurrent()->ThrowException(v8::Exception::TypeError(v8::String::NewFromUtf8(v8::Isolate::GetCurrent(), "except cpp class, but wrong type")));
-                }
-                return nullptr;
+                v8::Isolate::GetCurrent()->ThrowException(v8::Exception::TypeError(v8::String::NewFromUtf8(v8::Isolate::GetCurrent(), "except cpp class, but wrong type", v8::NewStringType::kNormal).ToLocalChecked()));
             }
+            return nullptr;
         }
         return object;
     }
 
-    static v8::Persistent<v8::Object> persistent;
+    const CppTypeInfo *type{ nullptr };
+
+    uint32_t slot{ V8HandleTable::NONE };
+
+    size_t reported{ 0 };
 };
 
 template<typename T>
 class CppObjectValue : public CppObject
 {
+    friend class CppObject;
+
 private:
     CppObjectValue()
     {
@@ -174,24 +367,32 @@ public:
         }
     }
 
+    virtual size_t measure() override
+    {
+        return sizeof(*this) - sizeof(T) + V8ExternalSize<T>::of(*static_cast<T *>(objectPtr()));
+    }
+
     template<typename... P>
     static void instance(v8::Local<v8::Object> self, P &&... args)
     {
-        auto instance = allocate<CppObjectValue<T>>(self);
+        auto instance = allocate<CppObjectValue<T>>(self, CppTypeInfo::get<T>());
         ::new(instance->objectPtr()) T(std::forward<P>(args)...);
+        instance->account(v8::Isolate::GetCurrent());
     }
 
     template<typename... P>
     static void instance(v8::Local<v8::Object> self, std::tuple<P...> &args)
     {
-        auto instance = allocate<CppObjectValue<T>>(self);
+        auto instance = allocate<CppObjectValue<T>>(self, CppTypeInfo::get<T>());
         CppInvokeClassConstructor<T>::call(instance->objectPtr(), args);
+        instance->account(v8::Isolate::GetCurrent());
     }
 
     static void instance(v8::Local<v8::Object> self, const T &obj)
     {
-        auto instance = allocate<CppObjectValue<T>>(self);
+        auto instance = allocate<CppObjectValue<T>>(self, CppTypeInfo::get<T>());
         ::new(instance->objectPtr()) T(obj);
+        instance->account(v8::Isolate::GetCurrent());
     }
 
 private:
@@ -208,12 +409,18 @@ public:
         return ptr;
     }
 
+    virtual size_t measure() override
+    {
+        return sizeof(*this);
+    }
+
     template<typename T>
     static void instance(v8::Local<v8::Object> self, T *obj)
     {
-        auto instance = allocate<CppObjectPtr>(self);
+        auto instance = allocate<CppObjectPtr>(self, CppTypeInfo::get<typename std::remove_cv<T>::type>());
         instance->ptr = obj;
         assert(instance->ptr);
+        instance->account(v8::Isolate::GetCurrent());
     }
 
 private:
@@ -234,6 +441,11 @@ public:
         return const_cast<T *>(&*sp);
     }
 
+    virtual size_t measure() override
+    {
+        return sizeof(*this) + (sp ? V8ExternalSize<T>::of(*sp) : 0);
+    }
+
     SP &sharedPtr()
     {
         return sp;
@@ -241,14 +453,16 @@ public:
 
     static void instance(v8::Local<v8::Object> self, T *obj)
     {
-        auto instance = allocate<CppObjectSharedPtr<SP, T>>(self);
+        auto instance = allocate<CppObjectSharedPtr<SP, T>>(self, CppTypeInfo::get<typename std::remove_cv<T>::type>());
         instance->sp.reset(obj);
+        instance->account(v8::Isolate::GetCurrent());
     }
 
     static void instance(v8::Local<v8::Object> self, const SP &sp)
     {
-        auto instance = allocate<CppObjectSharedPtr<SP, T>>(self);
+        auto instance = allocate<CppObjectSharedPtr<SP, T>>(self, CppTypeInfo::get<typename std::remove_cv<T>::type>());
         instance->sp = sp;
+        instance->account(v8::Isolate::GetCurrent());
     }
 
 private:
@@ -275,6 +489,85 @@ struct CppObjectTraits<std::shared_ptr<T>>
     static constexpr bool isSharedConst = std::is_const<T>::value;
 };
 
+/**
+ * Opt-in identity cache of a bound class, off by default: specialize as std::true_type, e.g.
+ * template<> struct V8IdentityCache<Node> : std::true_type {};
+ * so the wrappers of its objects returned by pointer or shared_ptr are looked up in the per-isolate
+ * wrapper cache first, and the same native object maps to the same JS object while it is alive.
+ */
+template<typename T>
+struct V8IdentityCache : std::false_type {};
+
+/**
+ * Create the JS wrapper of a native object returned to JS, from the instance template of its bound class
+ * in the current isolate.
+ * fill(self) attaches the holder to the new wrapper. Wrappers of classes with the identity cache
+ * are cached by object, type and holder kind, so a pointer and a shared_ptr to the same object
+ * never share a wrapper with the wrong ownership.
+ */
+template<typename T>
+struct CppObjectWrapper
+{
+    enum Kind
+    {
+        POINTER,
+        SHARED_PTR
+    };
+
+    template<typename FILL>
+    static v8::Local<v8::Value> create(const FILL &fill)
+    {
+        auto isolate = v8::Isolate::GetCurrent();
+        auto handle = V8IsolateData::get(isolate).templates.getClass(isolate, &CppTypeInfo::get<T>());
+        if (handle.IsEmpty())
+        {
+            isolate->ThrowException(v8::Exception::TypeError(v8::String::NewFromUtf8(isolate, "except bound cpp class", v8::NewStringType::kNormal).ToLocalChecked()));
+            return v8::Undefined(isolate);
+        }
+        v8::EscapableHandleScope scope(isolate);
+        auto templ = handle->InstanceTemplate();
+        auto self = templ->NewInstance(isolate->GetCurrentContext()).ToLocalChecked();
+        fill(self);
+        return scope.Escape(self);
+    }
+
+    template<typename FILL>
+    static v8::Local<v8::Value> get(const T *ptr, Kind kind, const FILL &fill)
+    {
+        if (!V8IdentityCache<T>::value)
+        {
+            return create(fill);
+        }
+        auto isolate = v8::Isolate::GetCurrent();
+        auto &cache = V8IsolateData::get(isolate).wrappers;
+        auto type = &CppTypeInfo::get<T>();
+        auto cached = cache.get(isolate, ptr, type, kind);
+        if (!cached.IsEmpty())
+        {
+            return cached;
+        }
+        auto self = create(fill);
+        if (self->IsObject())
+        {
+            cache.set(isolate, ptr, type, kind, self.template As<v8::Object>());
+        }
+        return self;
+    }
+
+    /** Cached wrapper of an object, of either holder kind, or an empty handle */
+    static v8::Local<v8::Object> find(v8::Isolate *isolate, const T *ptr)
+    {
+        if (!V8IdentityCache<T>::value)
+        {
+            return v8::Local<v8::Object>();
+        }
+        auto &cache = V8IsolateData::get(isolate).wrappers;
+        auto type = &CppTypeInfo::get<T>();
+        auto self = cache.get(isolate, ptr, type, POINTER);
+        return self.IsEmpty() ? cache.get(isolate, ptr, type, SHARED_PTR) : self;
+    }
+};
+
 template<typename SP, typename OBJ, bool IS_SHARED, bool IS_REF>
 struct V8CppObjectFactory;
 
@@ -283,12 +576,17 @@ struct V8CppObjectFactory<T, T, false, false>
 {
     static void instance(v8::Local<v8::Object> self, const T &obj)
     {
-        CppObjectValue<T>::instance(self);
+        CppObjectValue<T>::instance(self, obj);
+    }
+
+    static v8::Local<v8::Value> set(const T &obj)
+    {
+        return CppObjectWrapper<T>::create([&obj](v8::Local<v8::Object> self) { instance(self, obj); });
     }
 
     static T &cast(v8::Local<v8::Object> self, CppObject *obj)
     {
-        return *static_cast<T *>(obj->objectPtr());
+        return *obj->template objectAs<T>();
     }
 };
 
@@ -300,9 +598,14 @@ struct V8CppObjectFactory<T, T, false, true>
         CppObjectPtr::instance(self, const_cast<T *>(&obj));
     }
 
+    static v8::Local<v8::Value> set(const T &obj)
+    {
+        return CppObjectWrapper<T>::get(&obj, CppObjectWrapper<T>::POINTER, [&obj](v8::Local<v8::Object> self) { instance(self, obj); });
+    }
+
     static T &cast(v8::Local<v8::Object> self, CppObject *obj)
     {
-        return *static_cast<T *>(obj->objectPtr());
+        return *obj->template objectAs<T>();
     }
 };
 
@@ -317,12 +620,21 @@ struct V8CppObjectFactory<SP, T, true, true>
         }
     }
 
+    static v8::Local<v8::Value> set(const SP &sp)
+    {
+        if (!sp)
+        {
+            return v8::Null(v8::Isolate::GetCurrent());
+        }
+        return CppObjectWrapper<T>::get(&*sp, CppObjectWrapper<T>::SHARED_PTR, [&sp](v8::Local<v8::Object> self) { instance(self, sp); });
+    }
+
     static SP &cast(v8::Local<v8::Object> self, CppObject *obj)
     {
         if (!obj->isSharedPtr())
         {
             v8::HandleScope scope(v8::Isolate::GetCurrent());
-            v8::Isolate::GetCurrent()->ThrowException(v8::Exception::TypeError(v8::String::NewFromUtf8(v8::Isolate::GetCurrent(), "is not shared object!")));
+            v8::Isolate::GetCurrent()->ThrowException(v8::Exception::TypeError(v8::String::NewFromUtf8(v8::Isolate::GetCurrent(), "is not shared object!", v8::NewStringType::kNormal).ToLocalChecked()));
         }
         return static_cast<CppObjectSharedPtr<SP, T> *>(obj)->sharedPtr();
     }
@@ -342,6 +654,11 @@ struct V8ClassMapping
         V8CppObjectFactory<T, ObjectType, isShared, isRef>::instance(self, t);
     }
 
+    static v8::Local<v8::Value> set(const T &t)
+    {
+        return V8CppObjectFactory<T, ObjectType, isShared, isRef>::set(t);
+    }
+
     static T &get(v8::Local<v8::Object> self)
     {
         CppObject *obj = CppObject::getObject<ObjectType>(self);
@@ -371,6 +688,15 @@ struct V8TypeMapping<T *>
         }
     }
 
+    static v8::Local<v8::Value> set(const Type *p)
+    {
+        if (p == nullptr)
+        {
+            return v8::Null(v8::Isolate::GetCurrent());
+        }
+        return CppObjectWrapper<Type>::get(p, CppObjectWrapper<Type>::POINTER, [p](v8::Local<v8::Object> self) { instance(self, p); });
+    }
+
     static PtrType get(v8::Local<v8::Object> self)
     {
         return CppObject::get<Type>(self);
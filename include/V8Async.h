@@ -0,0 +1,373 @@
+#pragma once
+
+#include "CppArg.h"
+#include "CppFastCall.h"
+#include "CppInvoke.h"
+#include "CppObject.h"
+#include "V8Isolate.h"
+#include "V8Type.h"
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include <v8.h>
+
+/**
+ * Fixed-size pool of native worker threads running async bindings.
+ * The shared pool is created on first use, with the size given to configure() (default: one thread per core).
+ */
+class V8ThreadPool
+{
+public:
+    explicit V8ThreadPool(size_t size)
+    {
+        if (size == 0)
+        {
+            size = 1;
+        }
+        for (size_t i = 0; i < size; ++i)
+        {
+            workers.emplace_back([this] { work(); });
+        }
+    }
+
+    ~V8ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopped = true;
+        }
+        condition.notify_all();
+        for (auto &worker : workers)
+        {
+            worker.join();
+        }
+    }
+
+    V8ThreadPool(const V8ThreadPool &) = delete;
+
+    V8ThreadPool &operator=(const V8ThreadPool &) = delete;
+
+    void post(std::function<void()> task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.push_back(std::move(task));
+        }
+        condition.notify_one();
+    }
+
+    size_t size() const
+    {
+        return workers.size();
+    }
+
+    static void configure(size_t size)
+    {
+        sharedSize() = size;
+    }
+
+    static V8ThreadPool &shared()
+    {
+        static V8ThreadPool pool(sharedSize());
+        return pool;
+    }
+
+private:
+    void work()
+    {
+        while (true)
+        {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                condition.wait(lock, [this] { return stopped || !tasks.empty(); });
+                if (tasks.empty())
+                {
+                    return;
+                }
+                task = std::move(tasks.front());
+                tasks.pop_front();
+            }
+            task();
+        }
+    }
+
+    static size_t &sharedSize()
+    {
+        static size_t size = std::thread::hardware_concurrency();
+        return size;
+    }
+
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::deque<std::function<void()>> tasks;
+    std::vector<std::thread> workers;
+    bool stopped{ false };
+};
+
+/**
+ * One call of an async binding. It is created on the isolate thread with the converted arguments,
+ * executed on the thread pool, then the promise is settled on the isolate thread when the
+ * completion queue of the isolate is drained. The call arguments and receiver are kept alive until then.
+ */
+class V8AsyncJob
+{
+public:
+    virtual ~V8AsyncJob() {}
+
+    v8::Local<v8::Promise> submit(const v8::FunctionCallbackInfo<v8::Value> &v8Args)
+    {
+        isolate = v8Args.GetIsolate();
+        auto context = isolate->GetCurrentContext();
+        auto resolver = v8::Promise::Resolver::New(context).ToLocalChecked();
+        this->context.Reset(isolate, context);
+        this->resolver.Reset(isolate, resolver);
+        handles.reserve(v8Args.Length() + 1);
+        handles.emplace_back(isolate, v8Args.This());
+        for (int i = 0; i < v8Args.Length(); ++i)
+        {
+            handles.emplace_back(isolate, v8Args[i]);
+        }
+        completions = V8IsolateData::get(isolate).completions;
+        completions->hold();
+        V8ThreadPool::shared().post([this]
+        {
+            run();
+            auto queue = completions;
+            queue->postHeld([this] { complete(); });
+        });
+        return resolver->GetPromise();
+    }
+
+protected:
+    /** Runs on a pool thread */
+    virtual void execute() = 0;
+
+    /** Runs on the isolate thread after a successful execute */
+    virtual v8::Local<v8::Value> value() = 0;
+
+private:
+    void run()
+    {
+        try
+        {
+            execute();
+        }
+        catch (const std::exception &e)
+        {
+            failed = true;
+            error = e.what();
+        }
+        catch (...)
+        {
+            failed = true;
+            error = "unknown exception";
+        }
+    }
+
+    void complete()
+    {
+        std::unique_ptr<V8AsyncJob> self(this);
+        v8::HandleScope scope(isolate);
+        auto context = this->context.Get(isolate);
+        v8::Context::Scope contextScope(context);
+        auto resolver = this->resolver.Get(isolate);
+        if (failed)
+        {
+            resolver->Reject(context, v8::Exception::Error(v8::String::NewFromUtf8(isolate, error.c_str(), v8::NewStringType::kNormal).ToLocalChecked())).FromMaybe(false);
+        }
+        else
+        {
+            resolver->Resolve(context, value()).FromMaybe(false);
+        }
+    }
+
+    v8::Isolate *isolate{ nullptr };
+    v8::Global<v8::Context> context;
+    v8::Global<v8::Promise::Resolver> resolver;
+    std::vector<v8::Global<v8::Value>> handles;
+    std::shared_ptr<V8CompletionQueue> completions;
+    bool failed{ false };
+    std::string error;
+};
+
+template<typename R>
+struct CppAsyncValue
+{
+    using ValueType = typename std::decay<R>::type;
+
+    template<typename CALL>
+    void run(const CALL &call)
+    {
+        value.reset(new ValueType(call()));
+    }
+
+    v8::Local<v8::Value> get() const
+    {
+        return V8Type<ValueType>::set(*value);
+    }
+
+    std::unique_ptr<ValueType> value;
+};
+
+template<>
+struct CppAsyncValue<void>
+{
+    template<typename CALL>
+    void run(const CALL &call)
+    {
+        call();
+    }
+
+    v8::Local<v8::Value> get() const
+    {
+        return v8::Undefined(v8::Isolate::GetCurrent());
+    }
+};
+
+/**
+ * Whether an argument can be handed to a pool thread: views (V8Span, V8StringView, V8ObjectView...)
+ * and JS handles point into the V8 heap and are only valid on the isolate thread during the call.
+ */
+template<typename T>
+struct CppAsyncArgOwning
+{
+    using Type = typename std::decay<typename CppArgTraits<T>::Type>::type;
+
+    static constexpr bool value = !V8TypeIsView<Type>::value;
+};
+
+template<typename... P>
+struct CppAsyncArgsOwning;
+
+template<>
+struct CppAsyncArgsOwning<>
+{
+    static constexpr bool value = true;
+};
+
+template<typename P0, typename... P>
+struct CppAsyncArgsOwning<P0, P...>
+{
+    static constexpr bool value = CppAsyncArgOwning<P0>::value && CppAsyncArgsOwning<P...>::value;
+};
+
+/**
+ * Async variant of a bound function: returns a promise of the result (converted with V8Type<R>::set).
+ * The arguments are converted on the isolate thread, so the C++ function must not take JS handles or views.
+ */
+template<typename FN, typename R, typename... P>
+struct CppBindAsyncMethod
+{
+    static_assert(CppAsyncArgsOwning<P...>::value, "async function arguments must not be views or JS handles");
+
+    using FunctionType = FN;
+
+    template<typename SOURCE>
+    using FastCall = CppFastMethodImpl<false, SOURCE, R>;
+
+    using Fast = FastCall<void>;
+
+    struct Job : V8AsyncJob
+    {
+        explicit Job(const FN &fn) : fn(fn) {}
+
+        virtual void execute() override
+        {
+            result.run([this] { return CppDispatchMethod<FN, R, CppArgTuple<P...>, sizeof...(P)>::call(fn, args); });
+        }
+
+        virtual v8::Local<v8::Value> value() override
+        {
+            return result.get();
+        }
+
+        FN fn;
+        CppArgTuple<P...> args;
+        CppAsyncValue<R> result;
+    };
+
+    static void call(const v8::FunctionCallbackInfo<v8::Value> &v8Args)
+    {
+        const FN &fn = *reinterpret_cast<const FN *>(v8Args.Data().As<v8::External>()->Value());
+        invoke(fn, v8Args);
+    }
+
+    static void invoke(const FN &fn, const v8::FunctionCallbackInfo<v8::Value> &v8Args)
+    {
+        std::unique_ptr<Job> job(new Job(fn));
+        if (!CppArgTupleInput<P...>::get(v8Args, 0, job->args))
+        {
+            return;
+        }
+        v8Args.GetReturnValue().Set(job.release()->submit(v8Args));
+    }
+};
+
+/**
+ * Async variant of a bound method, the method runs on a pool thread with the wrapped object,
+ * which is kept alive until the promise is settled.
+ */
+template<typename T, bool IS_PROXY, typename FN, typename R, typename... P>
+struct CppBindAsyncClassMethod
+{
+    static_assert(CppAsyncArgsOwning<P...>::value, "async method arguments must not be views or JS handles");
+
+    using FunctionType = FN;
+
+    template<typename SOURCE>
+    using FastCall = CppFastMethodImpl<false, SOURCE, R>;
+
+    using Fast = FastCall<void>;
+
+    struct Job : V8AsyncJob
+    {
+        Job(T *obj, const FN &fn) : obj(obj), fn(fn) {}
+
+        virtual void execute() override
+        {
+            result.run([this] { return CppDispatchClassMethod<T, IS_PROXY, FN, R, CppArgTuple<P...>, sizeof...(P)>::call(obj, fn, args); });
+        }
+
+        virtual v8::Local<v8::Value> value() override
+        {
+            return result.get();
+        }
+
+        T *obj;
+        FN fn;
+        CppArgTuple<P...> args;
+        CppAsyncValue<R> result;
+    };
+
+    static void call(const v8::FunctionCallbackInfo<v8::Value> &v8Args)
+    {
+        auto fn = static_cast<const FN *>(v8Args.Data().As<v8::External>()->Value());
+        invoke(*fn, v8Args);
+    }
+
+    static void invoke(const FN &fn, const v8::FunctionCallbackInfo<v8::Value> &v8Args)
+    {
+        T *obj = CppObject::cast<T>(v8Args.This());
+        if (obj == nullptr)
+        {
+            v8::Isolate::GetCurrent()->ThrowException(v8::Exception::TypeError(v8::String::NewFromUtf8(v8::Isolate::GetCurrent(), "except cpp class, but wrong type", v8::NewStringType::kNormal).ToLocalChecked()));
+            return;
+        }
+        std::unique_ptr<Job> job(new Job(obj, fn));
+        if (!CppArgTupleInput<P...>::get(v8Args, 0, job->args))
+        {
+            return;
+        }
+        v8Args.GetReturnValue().Set(job.release()->submit(v8Args));
+    }
+};
@@ -0,0 +1,332 @@
+#pragma once
+
+#include "CppObject.h"
+#include "V8Isolate.h"
+#include "V8Type.h"
+
+#include <memory>
+#include <type_traits>
+
+#include <v8.h>
+
+/**
+ * Expose a C++ container to V8 by reference. The JS object is a proxy whose element access,
+ * length and iteration go through interceptors that read and write the C++ container in place,
+ * so nothing is materialized until the script touches it.
+ * Sequence containers (vector, deque, array) behave like array-likes with length, for...of and forEach,
+ * maps are exposed by key (named keys for string-like key types, indices for arithmetic key types).
+ * A reference wrapper does not own the container, so it must outlive the JS proxy;
+ * a shared_ptr wrapper keeps the container alive until the proxy is collected.
+ */
+template<typename C>
+class V8ContainerRef
+{
+public:
+    using ContainerType = C;
+
+    V8ContainerRef() {}
+
+    explicit V8ContainerRef(C &container) : ptr(&container) {}
+
+    explicit V8ContainerRef(const std::shared_ptr<C> &container) : ptr(container.get()), sp(container) {}
+
+    C &container() const
+    {
+        assert(ptr);
+        return *ptr;
+    }
+
+    const std::shared_ptr<C> &sharedPtr() const
+    {
+        return sp;
+    }
+
+private:
+    C *ptr{ nullptr };
+    std::shared_ptr<C> sp;
+};
+
+template<typename C>
+struct V8ContainerRefAccess
+{
+    using Type = typename std::remove_const<C>::type;
+
+    static constexpr bool isConst = std::is_const<C>::value;
+
+    static C &container(const v8::Local<v8::Object> &self)
+    {
+        auto object = static_cast<CppObject *>(self->GetAlignedPointerFromInternalField(0));
+        assert(object);
+        return *static_cast<C *>(object->objectPtr());
+    }
+
+    static void throwReadOnly()
+    {
+        v8::Isolate::GetCurrent()->ThrowException(v8::Exception::TypeError(v8::String::NewFromUtf8(v8::Isolate::GetCurrent(), "container is read-only", v8::NewStringType::kNormal).ToLocalChecked()));
+    }
+};
+
+struct V8ContainerAppend
+{
+    template<typename C, typename V>
+    static auto append(C &c, V &&v, int) -> decltype(c.push_back(std::forward<V>(v)), bool())
+    {
+        c.push_back(std::forward<V>(v));
+        return true;
+    }
+
+    template<typename C, typename V>
+    static bool append(C &, V &&, long)
+    {
+        return false;
+    }
+};
+
+template<typename C, typename ENABLED = void>
+struct V8ContainerRefSequence
+    : V8ContainerRefAccess<C>
+{
+    using Access = V8ContainerRefAccess<C>;
+    using ValueType = typename Access::Type::value_type;
+
+    static void getter(uint32_t index, const v8::PropertyCallbackInfo<v8::Value> &info)
+    {
+        auto &c = Access::container(info.Holder());
+        if (index < c.size())
+        {
+            V8ReturnValue<const ValueType &>::set(info.GetReturnValue(), c[index]);
+        }
+    }
+
+    static void setter(uint32_t index, v8::Local<v8::Value> value, const v8::PropertyCallbackInfo<v8::Value> &info)
+    {
+        assign(Access::container(info.Holder()), index, value, std::integral_constant<bool, Access::isConst>());
+        info.GetReturnValue().Set(value);
+    }
+
+    static void query(uint32_t index, const v8::PropertyCallbackInfo<v8::Integer> &info)
+    {
+        if (index < Access::container(info.Holder()).size())
+        {
+            info.GetReturnValue().Set(static_cast<int32_t>(v8::DontDelete));
+        }
+    }
+
+    static void enumerator(const v8::PropertyCallbackInfo<v8::Array> &info)
+    {
+        auto size = Access::container(info.Holder()).size();
+        auto array = v8::Array::New(v8::Isolate::GetCurrent(), static_cast<int>(size));
+        auto context = v8::Isolate::GetCurrent()->GetCurrentContext();
+        for (uint32_t i = 0; i < size; ++i)
+        {
+            array->Set(context, i, v8::Integer::NewFromUnsigned(v8::Isolate::GetCurrent(), i)).FromJust();
+        }
+        info.GetReturnValue().Set(array);
+    }
+
+    static void length(v8::Local<v8::String>, const v8::PropertyCallbackInfo<v8::Value> &info)
+    {
+        info.GetReturnValue().Set(static_cast<uint32_t>(Access::container(info.Holder()).size()));
+    }
+
+    static void configure(v8::Local<v8::ObjectTemplate> templ)
+    {
+        templ->SetHandler(v8::IndexedPropertyHandlerConfiguration(&getter, &setter, &query, nullptr, &enumerator));
+        templ->SetAccessor(V8_KEY("length"), &length, nullptr, v8::Local<v8::Value>(), v8::DEFAULT, static_cast<v8::PropertyAttribute>(v8::ReadOnly | v8::DontEnum | v8::DontDelete));
+        templ->SetIntrinsicDataProperty(v8::Symbol::GetIterator(v8::Isolate::GetCurrent()), v8::kArrayProto_values, v8::DontEnum);
+        templ->SetIntrinsicDataProperty(V8_KEY("forEach"), v8::kArrayProto_forEach, v8::DontEnum);
+        templ->SetIntrinsicDataProperty(V8_KEY("keys"), v8::kArrayProto_keys, v8::DontEnum);
+        templ->SetIntrinsicDataProperty(V8_KEY("entries"), v8::kArrayProto_entries, v8::DontEnum);
+    }
+
+private:
+    template<typename CC>
+    static void assign(CC &c, uint32_t index, v8::Local<v8::Value> value, std::false_type)
+    {
+        if (index < c.size())
+        {
+            c[index] = V8Type<ValueType>::get(value);
+        }
+        else if (index != c.size() || !V8ContainerAppend::append(c, V8Type<ValueType>::get(value), 0))
+        {
+            v8::Isolate::GetCurrent()->ThrowException(v8::Exception::RangeError(v8::String::NewFromUtf8(v8::Isolate::GetCurrent(), "container index out of range", v8::NewStringType::kNormal).ToLocalChecked()));
+        }
+    }
+
+    template<typename CC>
+    static void assign(CC &, uint32_t, v8::Local<v8::Value>, std::true_type)
+    {
+        Access::throwReadOnly();
+    }
+};
+
+template<typename C>
+struct V8ContainerRefMap
+    : V8ContainerRefAccess<C>
+{
+    using Access = V8ContainerRefAccess<C>;
+    using KeyType = typename Access::Type::key_type;
+    using ValueType = typename Access::Type::mapped_type;
+
+    template<typename KEY>
+    static void getter(KEY key, const v8::PropertyCallbackInfo<v8::Value> &info)
+    {
+        auto &c = Access::container(info.Holder());
+        auto it = c.find(toKey(key));
+        if (it != c.end())
+        {
+            V8ReturnValue<const ValueType &>::set(info.GetReturnValue(), it->second);
+        }
+    }
+
+    template<typename KEY>
+    static void setter(KEY key, v8::Local<v8::Value> value, const v8::PropertyCallbackInfo<v8::Value> &info)
+    {
+        assign(Access::container(info.Holder()), key, value, std::integral_constant<bool, Access::isConst>());
+        info.GetReturnValue().Set(value);
+    }
+
+    template<typename KEY>
+    static void query(KEY key, const v8::PropertyCallbackInfo<v8::Integer> &info)
+    {
+        auto &c = Access::container(info.Holder());
+        if (c.find(toKey(key)) != c.end())
+        {
+            info.GetReturnValue().Set(static_cast<int32_t>(v8::None));
+        }
+    }
+
+    template<typename KEY>
+    static void deleter(KEY key, const v8::PropertyCallbackInfo<v8::Boolean> &info)
+    {
+        erase(Access::container(info.Holder()), key, std::integral_constant<bool, Access::isConst>());
+        info.GetReturnValue().Set(true);
+    }
+
+    static void enumerator(const v8::PropertyCallbackInfo<v8::Array> &info)
+    {
+        auto &c = Access::container(info.Holder());
+        std::vector<v8::Local<v8::Value>> keys;
+        keys.reserve(c.size());
+        for (auto &pair : c)
+        {
+            keys.push_back(V8Type<KeyType>::set(pair.first));
+        }
+        info.GetReturnValue().Set(V8ArrayNew(keys));
+    }
+
+    static void configure(v8::Local<v8::ObjectTemplate> templ)
+    {
+        configure(templ, std::is_arithmetic<KeyType>());
+    }
+
+private:
+    static KeyType toKey(uint32_t index)
+    {
+        return static_cast<KeyType>(index);
+    }
+
+    static KeyType toKey(v8::Local<v8::Name> name)
+    {
+        return V8Type<KeyType>::get(name.As<v8::Value>());
+    }
+
+    static void configure(v8::Local<v8::ObjectTemplate> templ, std::true_type)
+    {
+        templ->SetHandler(v8::IndexedPropertyHandlerConfiguration(&getter<uint32_t>, &setter<uint32_t>, &query<uint32_t>, &deleter<uint32_t>, &enumerator));
+    }
+
+    static void configure(v8::Local<v8::ObjectTemplate> templ, std::false_type)
+    {
+        templ->SetHandler(v8::NamedPropertyHandlerConfiguration(&getter<v8::Local<v8::Name>>, &setter<v8::Local<v8::Name>>, &query<v8::Local<v8::Name>>, &deleter<v8::Local<v8::Name>>, &enumerator,
+                                                                v8::Local<v8::Value>(), v8::PropertyHandlerFlags::kOnlyInterceptStrings));
+    }
+
+    template<typename CC, typename KEY>
+    static void assign(CC &c, KEY key, v8::Local<v8::Value> value, std::false_type)
+    {
+        c[toKey(key)] = V8Type<ValueType>::get(value);
+    }
+
+    template<typename CC, typename KEY>
+    static void assign(CC &, KEY, v8::Local<v8::Value>, std::true_type)
+    {
+        Access::throwReadOnly();
+    }
+
+    template<typename CC, typename KEY>
+    static void erase(CC &c, KEY key, std::false_type)
+    {
+        c.erase(toKey(key));
+    }
+
+    template<typename CC, typename KEY>
+    static void erase(CC &, KEY, std::true_type)
+    {
+        Access::throwReadOnly();
+    }
+};
+
+template<typename C, typename ENABLED = void>
+struct V8ContainerRefKind
+    : V8ContainerRefSequence<C> {};
+
+template<typename C>
+struct V8ContainerRefKind<C, typename std::enable_if<sizeof(typename std::remove_const<C>::type::mapped_type) != 0>::type>
+    : V8ContainerRefMap<C> {};
+
+template<typename C>
+struct V8ContainerRefTemplate
+{
+    static v8::Local<v8::ObjectTemplate> get()
+    {
+        static const char tag = 0;
+        auto isolate = v8::Isolate::GetCurrent();
+        return V8IsolateData::get(isolate).templates.get(isolate, &tag, [isolate]() -> v8::Local<v8::ObjectTemplate>
+        {
+            auto templ = v8::ObjectTemplate::New(isolate);
+            templ->SetInternalFieldCount(1);
+            V8ContainerRefKind<C>::configure(templ);
+            return templ;
+        });
+    }
+};
+
+template<typename C>
+struct V8TypeMapping<V8ContainerRef<C>>
+{
+    static v8::Local<v8::Object> set(const V8ContainerRef<C> &ref)
+    {
+        using Type = typename std::remove_const<C>::type;
+        v8::EscapableHandleScope scope(v8::Isolate::GetCurrent());
+        auto context = v8::Isolate::GetCurrent()->GetCurrentContext();
+        auto self = V8ContainerRefTemplate<C>::get()->NewInstance(context).ToLocalChecked();
+        if (ref.sharedPtr())
+        {
+            CppObjectSharedPtr<std::shared_ptr<C>, Type>::instance(self, ref.sharedPtr());
+        }
+        else
+        {
+            CppObjectPtr::instance(self, const_cast<Type *>(&ref.container()));
+        }
+        return scope.Escape(self);
+    }
+
+    static V8ContainerRef<C> get(v8::MaybeLocal<v8::Value> handle)
+    {
+        using Type = typename std::remove_const<C>::type;
+        auto value = handle.ToLocalChecked();
+        Type *container = value->IsObject() ? CppObject::cast<Type>(value.As<v8::Object>()) : nullptr;
+        if (container == nullptr)
+        {
+            v8::Isolate::GetCurrent()->ThrowException(v8::Exception::TypeError(v8::String::NewFromUtf8(v8::Isolate::GetCurrent(), "except container reference", v8::NewStringType::kNormal).ToLocalChecked()));
+            return V8ContainerRef<C>();
+        }
+        return V8ContainerRef<C>(*container);
+    }
+
+    static V8ContainerRef<C> opt(v8::MaybeLocal<v8::Value> handle, const V8ContainerRef<C> &def)
+    {
+        return handle.ToLocalChecked()->IsUndefined() ? def : get(handle);
+    }
+};
@@ -0,0 +1,787 @@
+#pragma once
+
+#include "CppObject.h"
+#include "V8Async.h"
+#include "V8Isolate.h"
+#include "V8Type.h"
+
+#include <v8.h>
+
+/**
+ * C++20 coroutines as bound function results: a function returning V8Task<T> returns a Promise to JS,
+ * V8Generator<T> an iterator and V8AsyncGenerator<T> an async iterator, whatever way it is bound.
+ * Coroutines always run on the isolate thread, a suspended coroutine is resumed through the completion
+ * queue of the isolate (see V8CompletionQueue), e.g. after co_await V8Yield() or co_await V8RunAsync(fn).
+ * Enabled when the compiler supports coroutines, define V8_BINDING_COROUTINE to 0 to disable.
+ */
+#ifndef V8_BINDING_COROUTINE
+#if defined(__cpp_impl_coroutine)
+#define V8_BINDING_COROUTINE 1
+#else
+#define V8_BINDING_COROUTINE 0
+#endif
+#endif
+
+#if V8_BINDING_COROUTINE
+
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+/**
+ * JS promise settled from a coroutine, on the isolate thread.
+ */
+class V8CoroutinePromise
+{
+public:
+    explicit V8CoroutinePromise(v8::Isolate *isolate) : isolate(isolate)
+    {
+        auto context = isolate->GetCurrentContext();
+        context_.Reset(isolate, context);
+        resolver.Reset(isolate, v8::Promise::Resolver::New(context).ToLocalChecked());
+    }
+
+    v8::Local<v8::Promise> promise() const
+    {
+        return resolver.Get(isolate)->GetPromise();
+    }
+
+    /** Resolve with the value returned by fn, or reject if it throws */
+    template<typename FN>
+    void resolve(const FN &fn)
+    {
+        v8::HandleScope scope(isolate);
+        auto context = context_.Get(isolate);
+        v8::Context::Scope contextScope(context);
+        try
+        {
+            resolver.Get(isolate)->Resolve(context, fn()).FromMaybe(false);
+        }
+        catch (const std::exception &e)
+        {
+            reject(e.what());
+        }
+        catch (...)
+        {
+            reject("unknown exception");
+        }
+    }
+
+    void reject(const char *message)
+    {
+        v8::HandleScope scope(isolate);
+        auto context = context_.Get(isolate);
+        v8::Context::Scope contextScope(context);
+        resolver.Get(isolate)->Reject(context, v8::Exception::Error(v8::String::NewFromUtf8(isolate, message, v8::NewStringType::kNormal).ToLocalChecked())).FromMaybe(false);
+    }
+
+private:
+    v8::Isolate *isolate;
+    v8::Global<v8::Context> context_;
+    v8::Global<v8::Promise::Resolver> resolver;
+};
+
+/**
+ * Base of the awaiters that suspend a coroutine and resume it later through the completion queue,
+ * in the context the coroutine was running in. The awaiter lives in the coroutine frame until it resumes.
+ */
+class V8CoroutineAwaiter
+{
+public:
+    V8CoroutineAwaiter() {}
+
+    V8CoroutineAwaiter(const V8CoroutineAwaiter &) = delete;
+
+    V8CoroutineAwaiter &operator=(const V8CoroutineAwaiter &) = delete;
+
+    bool await_ready() const noexcept
+    {
+        return false;
+    }
+
+protected:
+    /** Called on the isolate thread when the coroutine suspends */
+    void suspend(std::coroutine_handle<> handle)
+    {
+        isolate = v8::Isolate::GetCurrent();
+        context.Reset(isolate, isolate->GetCurrentContext());
+        completions = V8IsolateData::get(isolate).completions;
+        this->handle = handle;
+    }
+
+    /** Schedule the resumption, callable from any thread */
+    void post()
+    {
+        auto queue = completions;
+        queue->post([this] { resume(); });
+    }
+
+    /** Count the resumption as pending work until postHeld() (see V8CompletionQueue::hold) */
+    void hold()
+    {
+        completions->hold();
+    }
+
+    void postHeld()
+    {
+        auto queue = completions;
+        queue->postHeld([this] { resume(); });
+    }
+
+private:
+    void resume()
+    {
+        v8::HandleScope scope(isolate);
+        v8::Context::Scope contextScope(context.Get(isolate));
+        handle.resume();
+    }
+
+    v8::Isolate *isolate{ nullptr };
+    v8::Global<v8::Context> context;
+    std::shared_ptr<V8CompletionQueue> completions;
+    std::coroutine_handle<> handle;
+};
+
+/**
+ * co_await V8Yield() suspends the coroutine and lets the embedder loop run, it resumes on the next drain.
+ */
+class V8Yield : public V8CoroutineAwaiter
+{
+public:
+    void await_suspend(std::coroutine_handle<> handle)
+    {
+        suspend(handle);
+        post();
+    }
+
+    void await_resume() const noexcept {}
+};
+
+/**
+ * co_await V8RunAsync(fn) runs fn on the async thread pool (see V8ThreadPool) and resumes the coroutine
+ * on the isolate thread with its result, an exception thrown by fn is rethrown in the coroutine.
+ */
+template<typename FN>
+class V8RunAsyncAwaiter : public V8CoroutineAwaiter
+{
+public:
+    using ResultType = std::invoke_result_t<FN &>;
+
+    explicit V8RunAsyncAwaiter(FN fn) : fn(std::move(fn)) {}
+
+    void await_suspend(std::coroutine_handle<> handle)
+    {
+        suspend(handle);
+        hold();
+        V8ThreadPool::shared().post([this]
+        {
+            run();
+            postHeld();
+        });
+    }
+
+    ResultType await_resume()
+    {
+        if (exception)
+        {
+            std::rethrow_exception(exception);
+        }
+        if constexpr (!std::is_void_v<ResultType>)
+        {
+            return std::move(*value);
+        }
+    }
+
+private:
+    void run()
+    {
+        try
+        {
+            if constexpr (std::is_void_v<ResultType>)
+            {
+                fn();
+            }
+            else
+            {
+                value.emplace(fn());
+            }
+        }
+        catch (...)
+        {
+            exception = std::current_exception();
+        }
+    }
+
+    using ValueType = std::conditional_t<std::is_void_v<ResultType>, bool, ResultType>;
+
+    FN fn;
+    std::optional<ValueType> value;
+    std::exception_ptr exception;
+};
+
+template<typename FN>
+V8RunAsyncAwaiter<FN> V8RunAsync(FN fn)
+{
+    return V8RunAsyncAwaiter<FN>(std::move(fn));
+}
+
+struct V8TaskPromiseBase
+{
+    /** Resumes the awaiting coroutine, or reports the completion of a task started by the binding */
+    struct FinalAwaiter
+    {
+        bool await_ready() const noexcept
+        {
+            return false;
+        }
+
+        template<typename PROMISE>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<PROMISE> handle) noexcept
+        {
+            auto &promise = handle.promise();
+            if (promise.continuation)
+            {
+                return promise.continuation;
+            }
+            auto done = std::move(promise.done);
+            if (done)
+            {
+                done();
+            }
+            return std::noop_coroutine();
+        }
+
+        void await_resume() const noexcept {}
+    };
+
+    std::suspend_always initial_suspend() const noexcept
+    {
+        return {};
+    }
+
+    FinalAwaiter final_suspend() const noexcept
+    {
+        return {};
+    }
+
+    void unhandled_exception()
+    {
+        exception = std::current_exception();
+    }
+
+    void rethrow()
+    {
+        if (exception)
+        {
+            std::rethrow_exception(exception);
+        }
+    }
+
+    std::coroutine_handle<> continuation;
+    std::function<void()> done;
+    std::exception_ptr exception;
+};
+
+template<typename T>
+struct V8TaskPromise : V8TaskPromiseBase
+{
+    template<typename V>
+    void return_value(V &&v)
+    {
+        value.emplace(std::forward<V>(v));
+    }
+
+    T result()
+    {
+        rethrow();
+        return std::move(*value);
+    }
+
+    std::optional<T> value;
+};
+
+template<>
+struct V8TaskPromise<void> : V8TaskPromiseBase
+{
+    void return_void() {}
+
+    void result()
+    {
+        rethrow();
+    }
+};
+
+/**
+ * Lazily started coroutine producing a T. It can be awaited by another coroutine,
+ * or returned from a bound function to start it and get a promise of its result.
+ */
+template<typename T = void>
+class V8Task
+{
+public:
+    struct promise_type : V8TaskPromise<T>
+    {
+        V8Task get_return_object()
+        {
+            return V8Task(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+    };
+
+    V8Task(V8Task &&other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+
+    V8Task &operator=(V8Task &&other) noexcept
+    {
+        if (this != &other)
+        {
+            reset();
+            handle = std::exchange(other.handle, nullptr);
+        }
+        return *this;
+    }
+
+    ~V8Task()
+    {
+        reset();
+    }
+
+    bool await_ready() const noexcept
+    {
+        return !handle || handle.done();
+    }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> caller) noexcept
+    {
+        handle.promise().continuation = caller;
+        return handle;
+    }
+
+    T await_resume()
+    {
+        return handle.promise().result();
+    }
+
+    /**
+     * Run the task until its first suspension. The frame then owns itself,
+     * done(promise) is called on the isolate thread when it finishes and the frame is freed after.
+     */
+    template<typename DONE>
+    void start(DONE done)
+    {
+        auto h = std::exchange(handle, nullptr);
+        h.promise().done = [h, done]
+        {
+            done(h.promise());
+            h.destroy();
+        };
+        h.resume();
+    }
+
+private:
+    explicit V8Task(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+
+    void reset()
+    {
+        if (handle)
+        {
+            handle.destroy();
+            handle = nullptr;
+        }
+    }
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+template<typename T>
+struct V8TaskValue
+{
+    static v8::Local<v8::Value> get(V8TaskPromise<T> &promise)
+    {
+        return V8Type<T>::set(promise.result());
+    }
+};
+
+template<>
+struct V8TaskValue<void>
+{
+    static v8::Local<v8::Value> get(V8TaskPromise<void> &promise)
+    {
+        promise.result();
+        return v8::Undefined(v8::Isolate::GetCurrent());
+    }
+};
+
+template<typename T>
+struct V8TypeMapping<V8Task<T>>
+{
+    static v8::Local<v8::Promise> set(V8Task<T> task)
+    {
+        auto settle = std::make_shared<V8CoroutinePromise>(v8::Isolate::GetCurrent());
+        auto promise = settle->promise();
+        task.start([settle](V8TaskPromise<T> &result)
+        {
+            settle->resolve([&result] { return V8TaskValue<T>::get(result); });
+        });
+        return promise;
+    }
+};
+
+/**
+ * Synchronous generator: co_yield produces the values of a JS iterator, one resumption per next() call.
+ * It cannot co_await, use V8AsyncGenerator for producers that wait.
+ */
+template<typename T>
+class V8Generator
+{
+public:
+    struct promise_type
+    {
+        V8Generator get_return_object()
+        {
+            return V8Generator(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        std::suspend_always initial_suspend() const noexcept
+        {
+            return {};
+        }
+
+        std::suspend_always final_suspend() const noexcept
+        {
+            return {};
+        }
+
+        template<typename V>
+        std::suspend_always yield_value(V &&v)
+        {
+            value.emplace(std::forward<V>(v));
+            return {};
+        }
+
+        template<typename V>
+        std::suspend_never await_transform(V &&) = delete;
+
+        void return_void() {}
+
+        void unhandled_exception()
+        {
+            exception = std::current_exception();
+        }
+
+        std::optional<T> value;
+        std::exception_ptr exception;
+    };
+
+    V8Generator(V8Generator &&other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+
+    ~V8Generator()
+    {
+        if (handle)
+        {
+            handle.destroy();
+        }
+    }
+
+    bool done() const
+    {
+        return !handle || handle.done();
+    }
+
+    /** Resume up to the next value, returns false when finished (rethrows the exception of the coroutine) */
+    bool next()
+    {
+        if (done())
+        {
+            return false;
+        }
+        auto &promise = handle.promise();
+        promise.value.reset();
+        handle.resume();
+        if (promise.exception)
+        {
+            std::rethrow_exception(std::exchange(promise.exception, nullptr));
+        }
+        return !handle.done();
+    }
+
+    T &value()
+    {
+        return *handle.promise().value;
+    }
+
+private:
+    explicit V8Generator(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+/**
+ * Asynchronous generator: co_yield produces the values of a JS async iterator,
+ * and the coroutine can co_await between values (V8Task, V8Yield, V8RunAsync).
+ */
+template<typename T>
+class V8AsyncGenerator
+{
+public:
+    struct promise_type
+    {
+        /** Reports the suspension at co_yield or at the end to the pending next() call */
+        struct NotifyAwaiter
+        {
+            bool await_ready() const noexcept
+            {
+                return false;
+            }
+
+            void await_suspend(std::coroutine_handle<promise_type> handle) noexcept
+            {
+                auto notify = std::move(handle.promise().notify);
+                if (notify)
+                {
+                    notify();
+                }
+            }
+
+            void await_resume() const noexcept {}
+        };
+
+        V8AsyncGenerator get_return_object()
+        {
+            return V8AsyncGenerator(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        std::suspend_always initial_suspend() const noexcept
+        {
+            return {};
+        }
+
+        NotifyAwaiter final_suspend() const noexcept
+        {
+            return {};
+        }
+
+        template<typename V>
+        NotifyAwaiter yield_value(V &&v)
+        {
+            value.emplace(std::forward<V>(v));
+            return {};
+        }
+
+        void return_void() {}
+
+        void unhandled_exception()
+        {
+            exception = std::current_exception();
+        }
+
+        std::optional<T> value;
+        std::exception_ptr exception;
+        std::function<void()> notify;
+    };
+
+    V8AsyncGenerator(V8AsyncGenerator &&other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+
+    ~V8AsyncGenerator()
+    {
+        if (handle)
+        {
+            handle.destroy();
+        }
+    }
+
+    bool done() const
+    {
+        return !handle || handle.done();
+    }
+
+    bool pending() const
+    {
+        return !done() && handle.promise().notify != nullptr;
+    }
+
+    /** Resume up to the next value or the end, notify is called when the coroutine gets there */
+    void next(std::function<void()> notify)
+    {
+        auto &promise = handle.promise();
+        promise.value.reset();
+        promise.notify = std::move(notify);
+        handle.resume();
+    }
+
+    /** Value of the last co_yield, nullptr when finished (rethrows the exception of the coroutine) */
+    T *value()
+    {
+        auto &promise = handle.promise();
+        if (promise.exception)
+        {
+            std::rethrow_exception(std::exchange(promise.exception, nullptr));
+        }
+        return handle.done() ? nullptr : &*promise.value;
+    }
+
+private:
+    explicit V8AsyncGenerator(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+struct V8IteratorResult
+{
+    static v8::Local<v8::Object> get(v8::Local<v8::Value> value, bool done)
+    {
+        auto context = v8::Isolate::GetCurrent()->GetCurrentContext();
+        auto result = v8::Object::New(v8::Isolate::GetCurrent());
+        result->Set(context, V8_KEY("value"), value).FromJust();
+        result->Set(context, V8_KEY("done"), v8::Boolean::New(v8::Isolate::GetCurrent(), done)).FromJust();
+        return result;
+    }
+
+    static v8::Local<v8::Object> end()
+    {
+        return get(v8::Undefined(v8::Isolate::GetCurrent()), true);
+    }
+};
+
+template<typename T>
+struct V8GeneratorIterator
+{
+    using Type = V8Generator<T>;
+
+    static v8::Local<v8::Symbol> symbol()
+    {
+        return v8::Symbol::GetIterator(v8::Isolate::GetCurrent());
+    }
+
+    static void next(const v8::FunctionCallbackInfo<v8::Value> &info)
+    {
+        auto generator = CppObject::cast<Type>(info.This());
+        if (generator == nullptr)
+        {
+            v8::Isolate::GetCurrent()->ThrowException(v8::Exception::TypeError(v8::String::NewFromUtf8(v8::Isolate::GetCurrent(), "except generator", v8::NewStringType::kNormal).ToLocalChecked()));
+            return;
+        }
+        try
+        {
+            if (generator->next())
+            {
+                info.GetReturnValue().Set(V8IteratorResult::get(V8Type<T>::set(generator->value()), false));
+            }
+            else
+            {
+                info.GetReturnValue().Set(V8IteratorResult::end());
+            }
+        }
+        catch (const std::exception &e)
+        {
+            v8::Isolate::GetCurrent()->ThrowException(v8::Exception::Error(v8::String::NewFromUtf8(v8::Isolate::GetCurrent(), e.what(), v8::NewStringType::kNormal).ToLocalChecked()));
+        }
+        catch (...)
+        {
+            v8::Isolate::GetCurrent()->ThrowException(v8::Exception::Error(v8::String::NewFromUtf8(v8::Isolate::GetCurrent(), "unknown exception", v8::NewStringType::kNormal).ToLocalChecked()));
+        }
+    }
+};
+
+/**
+ * The iterator object is kept alive while a next() call is pending, so a coroutine waiting
+ * for a completion is never destroyed before it resumes.
+ */
+template<typename T>
+struct V8AsyncGeneratorIterator
+{
+    using Type = V8AsyncGenerator<T>;
+
+    static v8::Local<v8::Symbol> symbol()
+    {
+        return v8::Symbol::GetAsyncIterator(v8::Isolate::GetCurrent());
+    }
+
+    static void next(const v8::FunctionCallbackInfo<v8::Value> &info)
+    {
+        auto isolate = v8::Isolate::GetCurrent();
+        auto settle = std::make_shared<V8CoroutinePromise>(isolate);
+        info.GetReturnValue().Set(settle->promise());
+        auto generator = CppObject::cast<Type>(info.This());
+        if (generator == nullptr)
+        {
+            settle->reject("except async generator");
+        }
+        else if (generator->pending())
+        {
+            settle->reject("next() called before the previous value was settled");
+        }
+        else if (generator->done())
+        {
+            settle->resolve([] { return V8IteratorResult::end(); });
+        }
+        else
+        {
+            auto self = std::make_shared<v8::Global<v8::Object>>(isolate, info.This());
+            generator->next([generator, settle, self]
+            {
+                settle->resolve([generator]
+                {
+                    auto value = generator->value();
+                    return value ? V8IteratorResult::get(V8Type<T>::set(*value), false) : V8IteratorResult::end();
+                });
+            });
+        }
+    }
+};
+
+template<typename ITERATOR>
+struct V8IteratorTemplate
+{
+    static v8::Local<v8::ObjectTemplate> get()
+    {
+        static const char tag = 0;
+        auto isolate = v8::Isolate::GetCurrent();
+        return V8IsolateData::get(isolate).templates.get(isolate, &tag, [isolate]() -> v8::Local<v8::ObjectTemplate>
+        {
+            auto templ = v8::ObjectTemplate::New(isolate);
+            templ->SetInternalFieldCount(1);
+            templ->Set(V8_KEY("next"), v8::FunctionTemplate::New(isolate, &ITERATOR::next), v8::DontEnum);
+            templ->Set(ITERATOR::symbol(), v8::FunctionTemplate::New(isolate, &self), v8::DontEnum);
+            return templ;
+        });
+    }
+
+    static v8::Local<v8::Object> instance(typename ITERATOR::Type &&generator)
+    {
+        v8::EscapableHandleScope scope(v8::Isolate::GetCurrent());
+        auto context = v8::Isolate::GetCurrent()->GetCurrentContext();
+        auto self = get()->NewInstance(context).ToLocalChecked();
+        CppObjectValue<typename ITERATOR::Type>::instance(self, std::move(generator));
+        return scope.Escape(self);
+    }
+
+private:
+    static void self(const v8::FunctionCallbackInfo<v8::Value> &info)
+    {
+        info.GetReturnValue().Set(info.This());
+    }
+};
+
+template<typename T>
+struct V8TypeMapping<V8Generator<T>>
+{
+    static v8::Local<v8::Object> set(V8Generator<T> generator)
+    {
+        return V8IteratorTemplate<V8GeneratorIterator<T>>::instance(std::move(generator));
+    }
+};
+
+template<typename T>
+struct V8TypeMapping<V8AsyncGenerator<T>>
+{
+    static v8::Local<v8::Object> set(V8AsyncGenerator<T> generator)
+    {
+        return V8IteratorTemplate<V8AsyncGeneratorIterator<T>>::instance(std::move(generator));
+    }
+};
+
+#endif
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "V8Isolate.h"
+
+#include <functional>
+#include <future>
+#include <memory>
+#include <thread>
+#include <utility>
+
+#include <v8.h>
+
+/**
+ * Runs closures posted from any thread on the thread that owns an isolate.
+ * The closures go to the completion queue of the isolate (see V8CompletionQueue), so async completions,
+ * resumed coroutines and posted closures share one lock-free queue and one notify hook,
+ * and a burst of posts wakes the isolate thread once. drain() then runs the pending
+ * closures in batches, entering the isolate, a HandleScope and the context once per batch,
+ * and taking a v8::Locker first when the executor is created for an isolate used with lockers.
+ * Create, drain and destroy the executor on the isolate thread, and set the notify hook before posting.
+ */
+class V8IsolateExecutor
+{
+public:
+    V8IsolateExecutor(v8::Isolate *isolate, v8::Local<v8::Context> context, bool useLocker = false)
+        : isolate(isolate), context(isolate, context), useLocker(useLocker),
+          owner(std::this_thread::get_id()), tasks(V8IsolateData::get(isolate).completions) {}
+
+    V8IsolateExecutor(const V8IsolateExecutor &) = delete;
+
+    V8IsolateExecutor &operator=(const V8IsolateExecutor &) = delete;
+
+    v8::Isolate *getIsolate() const
+    {
+        return isolate;
+    }
+
+    void setNotify(std::function<void()> fn)
+    {
+        tasks->setNotify(std::move(fn));
+    }
+
+    /** Maximum number of closures run by one drain() call, so a busy queue does not starve the isolate thread */
+    void setBatchSize(size_t size)
+    {
+        batchSize = size > 0 ? size : 1;
+    }
+
+    void post(std::function<void()> task)
+    {
+        tasks->post(std::move(task));
+    }
+
+    /**
+     * Post fn and block until it has run, returning its result or rethrowing its exception.
+     * Called on the thread that created the executor, fn is run in place instead of waiting on itself,
+     * whether or not the isolate is entered at that point.
+     */
+    template<typename FN>
+    auto postAndWait(FN fn) -> decltype(fn())
+    {
+        if (std::this_thread::get_id() == owner)
+        {
+            return fn();
+        }
+        auto task = std::make_shared<std::packaged_task<decltype(fn())()>>(std::move(fn));
+        auto result = task->get_future();
+        post([task] { (*task)(); });
+        return result.get();
+    }
+
+    /**
+     * Run pending closures on the calling thread, at most the batch size, and return how many were run.
+     * If closures are left, the notify hook is called again. A JS exception thrown by a closure
+     * is cleared before the next one runs, closures that care must catch it themselves.
+     */
+    size_t drain()
+    {
+        if (tasks->empty())
+        {
+            // only clears the scheduled state, so the next post notifies again
+            return tasks->drain(0);
+        }
+        std::unique_ptr<v8::Locker> locker;
+        if (useLocker && !v8::Locker::IsLocked(isolate))
+        {
+            locker.reset(new v8::Locker(isolate));
+        }
+        v8::Isolate::Scope isolateScope(isolate);
+        v8::HandleScope scope(isolate);
+        v8::Context::Scope contextScope(context.Get(isolate));
+        v8::TryCatch tryCatch(isolate);
+        auto count = tasks->drain(batchSize, [&tryCatch] { tryCatch.Reset(); });
+        V8ExternalMemory::flush();
+        return count;
+    }
+
+private:
+    v8::Isolate *isolate;
+    v8::Global<v8::Context> context;
+    bool useLocker;
+    std::thread::id owner;
+    size_t batchSize{ 256 };
+    std::shared_ptr<V8CompletionQueue> tasks;
+};
@@ -0,0 +1,161 @@
+#pragma once
+
+#include "V8Type.h"
+
+#include <type_traits>
+
+#include <v8.h>
+
+template<typename R>
+struct V8FunctionResult
+{
+    using Scope = v8::HandleScope;
+
+    static R get(Scope &, v8::MaybeLocal<v8::Value> result)
+    {
+        return result.IsEmpty() ? R() : V8Type<R>::get(result);
+    }
+};
+
+template<>
+struct V8FunctionResult<void>
+{
+    using Scope = v8::HandleScope;
+
+    static void get(Scope &, v8::MaybeLocal<v8::Value>) {}
+};
+
+/** A JS handle result is escaped from the handle scope of the call, the cast to T is not checked */
+template<typename T>
+struct V8FunctionResult<v8::Local<T>>
+{
+    using Scope = v8::EscapableHandleScope;
+
+    static v8::Local<T> get(Scope &scope, v8::MaybeLocal<v8::Value> result)
+    {
+        v8::Local<v8::Value> value;
+        return result.ToLocal(&value) ? scope.Escape(value.As<T>()) : v8::Local<T>();
+    }
+};
+
+template<typename SIGNATURE>
+class V8Function;
+
+/**
+ * Typed handle to a JS function, usable as a bound argument type and storable as a member,
+ * e.g. void on(const char *name, V8Function<bool(int, std::string)> handler).
+ * The function is held by a Global and called with the arguments converted by V8Type<P>::set
+ * into an argv on the stack, the result is converted by V8Type<R>::get.
+ * When the JS function throws, the exception is left pending in the isolate and R() is returned,
+ * calling an empty handle returns R() without touching the isolate.
+ * Calls must happen on the isolate thread, within a handle scope and the context to call in.
+ */
+template<typename R, typename... P>
+class V8Function<R(P...)>
+{
+public:
+    V8Function() {}
+
+    explicit V8Function(v8::Local<v8::Function> fn) : isolate(v8::Isolate::GetCurrent()), function(isolate, fn) {}
+
+    V8Function(const V8Function &other) : isolate(other.isolate)
+    {
+        if (!other.function.IsEmpty())
+        {
+            function.Reset(isolate, other.function);
+        }
+    }
+
+    V8Function(V8Function &&other) noexcept : isolate(other.isolate), function(std::move(other.function)) {}
+
+    V8Function &operator=(const V8Function &other)
+    {
+        if (this != &other)
+        {
+            isolate = other.isolate;
+            function.Reset(isolate, other.function);
+        }
+        return *this;
+    }
+
+    V8Function &operator=(V8Function &&other) noexcept
+    {
+        isolate = other.isolate;
+        function = std::move(other.function);
+        return *this;
+    }
+
+    bool isEmpty() const
+    {
+        return function.IsEmpty();
+    }
+
+    explicit operator bool() const
+    {
+        return !function.IsEmpty();
+    }
+
+    v8::Local<v8::Function> handle() const
+    {
+        return function.Get(isolate);
+    }
+
+    void reset()
+    {
+        function.Reset();
+    }
+
+    R operator()(const P &... args) const
+    {
+        if (function.IsEmpty())
+        {
+            return R();
+        }
+        return call(v8::Undefined(isolate), args...);
+    }
+
+    R call(v8::Local<v8::Value> receiver, const P &... args) const
+    {
+        if (function.IsEmpty())
+        {
+            return R();
+        }
+        typename V8FunctionResult<R>::Scope scope(isolate);
+        v8::Local<v8::Value> argv[sizeof...(P) > 0 ? sizeof...(P) : 1] = { V8Type<P>::set(args)... };
+        auto result = function.Get(isolate)->Call(isolate->GetCurrentContext(), receiver, static_cast<int>(sizeof...(P)), argv);
+        return V8FunctionResult<R>::get(scope, result);
+    }
+
+private:
+    v8::Isolate *isolate{ nullptr };
+    v8::Global<v8::Function> function;
+};
+
+template<typename R, typename... P>
+struct V8TypeMapping<V8Function<R(P...)>>
+{
+    static v8::Local<v8::Value> set(const V8Function<R(P...)> &fn)
+    {
+        if (fn.isEmpty())
+        {
+            return v8::Undefined(v8::Isolate::GetCurrent());
+        }
+        return fn.handle();
+    }
+
+    static V8Function<R(P...)> get(v8::MaybeLocal<v8::Value> handle)
+    {
+        auto value = handle.ToLocalChecked();
+        if (!value->IsFunction())
+        {
+            v8::Isolate::GetCurrent()->ThrowException(v8::Exception::TypeError(v8::String::NewFromUtf8(v8::Isolate::GetCurrent(), "except function", v8::NewStringType::kNormal).ToLocalChecked()));
+            return V8Function<R(P...)>();
+        }
+        return V8Function<R(P...)>(value.As<v8::Function>());
+    }
+
+    static V8Function<R(P...)> opt(v8::MaybeLocal<v8::Value> handle, const V8Function<R(P...)> &def)
+    {
+        return handle.ToLocalChecked()->IsUndefined() ? def : get(handle);
+    }
+};
@@ -0,0 +1,710 @@
+#pragma once
+
+#include <v8.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#ifndef V8_BINDING_ISOLATE_SLOT
+#define V8_BINDING_ISOLATE_SLOT 0
+#endif
+
+/**
+ * FNV-1a hash of a string, usable at compile time for string literals.
+ */
+constexpr uint32_t V8KeyHash(const char *str, uint32_t hash = 2166136261u)
+{
+    return *str == 0 ? hash : V8KeyHash(str + 1, (hash ^ static_cast<unsigned char>(*str)) * 16777619u);
+}
+
+/**
+ * Per-isolate table of internalized property keys used by the binding layer.
+ * Each name is created once as an internalized string and kept in a v8::Eternal,
+ * further lookups are resolved by the name pointer (verified against the stored name)
+ * or by its hash, so registering members does not allocate new strings.
+ */
+class V8KeyTable
+{
+public:
+    V8KeyTable() {}
+
+    V8KeyTable(const V8KeyTable &) = delete;
+
+    V8KeyTable &operator=(const V8KeyTable &) = delete;
+
+    v8::Local<v8::String> get(v8::Isolate *isolate, const char *name)
+    {
+        auto cached = byPointer.find(name);
+        if (cached != byPointer.end() && strcmp(cached->second->name.c_str(), name) == 0)
+        {
+            return cached->second->key.Get(isolate);
+        }
+        auto entry = find(isolate, name, V8KeyHash(name));
+        byPointer[name] = entry;
+        return entry->key.Get(isolate);
+    }
+
+    v8::Local<v8::String> get(v8::Isolate *isolate, const char *name, uint32_t hash)
+    {
+        return find(isolate, name, hash)->key.Get(isolate);
+    }
+
+private:
+    struct Entry
+    {
+        std::string name;
+        v8::Eternal<v8::String> key;
+    };
+
+    const Entry *find(v8::Isolate *isolate, const char *name, uint32_t hash)
+    {
+        auto range = byHash.equal_range(hash);
+        for (auto it = range.first; it != range.second; ++it)
+        {
+            if (it->second.name == name)
+            {
+                return &it->second;
+            }
+        }
+        v8::HandleScope scope(isolate);
+        auto str = v8::String::NewFromUtf8(isolate, name, v8::NewStringType::kInternalized).ToLocalChecked();
+        auto it = byHash.emplace(hash, Entry());
+        it->second.name = name;
+        it->second.key.Set(isolate, str);
+        return &it->second;
+    }
+
+    std::unordered_multimap<uint32_t, Entry> byHash;
+    std::unordered_map<const char *, const Entry *> byPointer;
+};
+
+/**
+ * Per-isolate object templates created by the binding layer, e.g. for container proxies,
+ * and the function templates of the bound classes.
+ * Templates belong to the isolate they were created in, so they are kept here instead of in statics,
+ * identified by the address of a static tag of the code creating them (the type info of a bound class).
+ */
+class V8TemplateTable
+{
+public:
+    V8TemplateTable() {}
+
+    V8TemplateTable(const V8TemplateTable &) = delete;
+
+    V8TemplateTable &operator=(const V8TemplateTable &) = delete;
+
+    template<typename FN>
+    v8::Local<v8::ObjectTemplate> get(v8::Isolate *isolate, const void *tag, const FN &create)
+    {
+        auto it = templates.find(tag);
+        if (it == templates.end())
+        {
+            v8::HandleScope scope(isolate);
+            it = templates.emplace(tag, v8::Eternal<v8::ObjectTemplate>(isolate, create())).first;
+        }
+        return it->second.Get(isolate);
+    }
+
+    /** Function template of a bound class, empty when the class is not bound in this isolate */
+    v8::Local<v8::FunctionTemplate> getClass(v8::Isolate *isolate, const void *tag) const
+    {
+        auto it = classes.find(tag);
+        return it == classes.end() ? v8::Local<v8::FunctionTemplate>() : it->second.Get(isolate);
+    }
+
+    void setClass(v8::Isolate *isolate, const void *tag, v8::Local<v8::FunctionTemplate> templ)
+    {
+        classes.emplace(tag, v8::Eternal<v8::FunctionTemplate>(isolate, templ));
+    }
+
+private:
+    std::unordered_map<const void *, v8::Eternal<v8::ObjectTemplate>> templates;
+    std::unordered_map<const void *, v8::Eternal<v8::FunctionTemplate>> classes;
+};
+
+/**
+ * Unbounded lock-free queue with many producers and a single consumer (Vyukov's node based queue).
+ * push() is one atomic exchange and is safe from any thread, pop() and empty() must only be called by the consumer.
+ */
+template<typename T>
+class V8MpscQueue
+{
+public:
+    V8MpscQueue() : head(&stub), tail(&stub) {}
+
+    ~V8MpscQueue()
+    {
+        T value;
+        while (pop(value)) {}
+        if (tail != &stub)
+        {
+            delete tail;
+        }
+    }
+
+    V8MpscQueue(const V8MpscQueue &) = delete;
+
+    V8MpscQueue &operator=(const V8MpscQueue &) = delete;
+
+    void push(T value)
+    {
+        auto node = new Node(std::move(value));
+        auto prev = head.exchange(node, std::memory_order_acq_rel);
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    bool pop(T &value)
+    {
+        auto first = tail;
+        auto next = first->next.load(std::memory_order_acquire);
+        while (next == nullptr)
+        {
+            if (head.load(std::memory_order_acquire) == first)
+            {
+                return false;
+            }
+            // a producer has swapped the head but not linked its node yet
+            std::this_thread::yield();
+            next = first->next.load(std::memory_order_acquire);
+        }
+        value = std::move(next->value);
+        tail = next;
+        if (first != &stub)
+        {
+            delete first;
+        }
+        return true;
+    }
+
+    bool empty() const
+    {
+        return tail->next.load(std::memory_order_acquire) == nullptr && head.load(std::memory_order_acquire) == tail;
+    }
+
+private:
+    struct Node
+    {
+        Node() {}
+
+        explicit Node(T &&value) : value(std::move(value)) {}
+
+        T value;
+        std::atomic<Node *> next{ nullptr };
+    };
+
+    Node stub;
+    std::atomic<Node *> head;
+    Node *tail;
+};
+
+/**
+ * Tasks posted from other threads to be run on the isolate thread, e.g. the completion of async calls
+ * or the closures of a V8IsolateExecutor, which shares this queue so an isolate has a single wake-up.
+ * post() only pushes to a lock-free queue, and calls the notify hook when the queue goes from idle
+ * to scheduled, so the embedder wakes its loop (uv_async_send, a platform task...) once per burst
+ * and calls drain() on the isolate thread, which runs the pending tasks in order.
+ * Set the notify hook before tasks are posted.
+ */
+class V8CompletionQueue
+{
+public:
+    V8CompletionQueue() {}
+
+    V8CompletionQueue(const V8CompletionQueue &) = delete;
+
+    V8CompletionQueue &operator=(const V8CompletionQueue &) = delete;
+
+    void setNotify(std::function<void()> fn)
+    {
+        notify = std::move(fn);
+    }
+
+    void post(std::function<void()> task)
+    {
+        tasks.push(std::move(task));
+        schedule();
+    }
+
+    /** Count work that will post to the queue later from another thread, e.g. an async job on the pool */
+    void hold()
+    {
+        held.fetch_add(1);
+    }
+
+    /** Post the task of work counted by hold() */
+    void postHeld(std::function<void()> task)
+    {
+        post(std::move(task));
+        held.fetch_sub(1);
+    }
+
+    /**
+     * Wait for the held work and run every pending task, until nothing is left to run.
+     * Called on the isolate thread when the isolate data is disposed, so no task outlives the isolate.
+     */
+    void finish()
+    {
+        while (true)
+        {
+            drain();
+            if (held.load() == 0 && tasks.empty())
+            {
+                return;
+            }
+            std::this_thread::yield();
+        }
+    }
+
+    bool empty() const
+    {
+        return tasks.empty();
+    }
+
+    size_t drain(size_t limit = SIZE_MAX)
+    {
+        return drain(limit, [] {});
+    }
+
+    /**
+     * Run at most limit pending tasks, calling after() once each has run, and return how many were run.
+     * If tasks are left, the notify hook is called again.
+     */
+    template<typename FN>
+    size_t drain(size_t limit, const FN &after)
+    {
+        scheduled.store(false);
+        size_t count = 0;
+        std::function<void()> task;
+        while (count < limit && tasks.pop(task))
+        {
+            task();
+            task = nullptr;
+            after();
+            ++count;
+        }
+        if (!tasks.empty())
+        {
+            schedule();
+        }
+        return count;
+    }
+
+private:
+    void schedule()
+    {
+        if (!scheduled.exchange(true) && notify)
+        {
+            notify();
+        }
+    }
+
+    V8MpscQueue<std::function<void()>> tasks;
+    std::atomic<bool> scheduled{ false };
+    std::atomic<size_t> held{ 0 };
+    std::function<void()> notify;
+};
+
+/**
+ * Per-isolate slab allocator for the small objects created by the binding for every wrapped instance.
+ * Blocks are grouped in size classes of GRANULE bytes up to MAX_SIZE and carved from chunks,
+ * a freed block goes to the free list of its size class. The chunks are released together
+ * when the isolate data is disposed. Only used on the isolate thread.
+ */
+class V8SlabPool
+{
+public:
+    static constexpr size_t GRANULE = alignof(std::max_align_t) > 16 ? alignof(std::max_align_t) : 16;
+    static constexpr size_t MAX_SIZE = 256;
+    static constexpr size_t CHUNK_SIZE = 16384;
+
+    static constexpr bool fits(size_t size, size_t align)
+    {
+        return size > 0 && size <= MAX_SIZE && align <= GRANULE;
+    }
+
+    V8SlabPool() {}
+
+    V8SlabPool(const V8SlabPool &) = delete;
+
+    V8SlabPool &operator=(const V8SlabPool &) = delete;
+
+    void *allocate(size_t size)
+    {
+        auto &head = free[index(size)];
+        if (head == nullptr)
+        {
+            refill(head, (index(size) + 1) * GRANULE);
+        }
+        auto block = head;
+        head = block->next;
+        return block;
+    }
+
+    void deallocate(void *ptr, size_t size)
+    {
+        auto block = static_cast<Block *>(ptr);
+        auto &head = free[index(size)];
+        block->next = head;
+        head = block;
+    }
+
+private:
+    struct Block
+    {
+        Block *next;
+    };
+
+    static size_t index(size_t size)
+    {
+        return (size + GRANULE - 1) / GRANULE - 1;
+    }
+
+    void refill(Block *&head, size_t blockSize)
+    {
+        chunks.emplace_back(new unsigned char[CHUNK_SIZE]);
+        auto chunk = chunks.back().get();
+        for (size_t offset = CHUNK_SIZE / blockSize * blockSize; offset > 0; offset -= blockSize)
+        {
+            auto block = reinterpret_cast<Block *>(chunk + offset - blockSize);
+            block->next = head;
+            head = block;
+        }
+    }
+
+    Block *free[MAX_SIZE / GRANULE] = {};
+    std::vector<std::unique_ptr<unsigned char[]>> chunks;
+};
+
+/**
+ * Batched reporting of external memory to V8. Adjustments are summed in a thread-local delta
+ * and passed to AdjustAmountOfExternalAllocatedMemory once it exceeds V8_BINDING_EXTERNAL_MEMORY_BATCH
+ * bytes either way, when another isolate is adjusted on the same thread, or on flush(),
+ * which the executor calls after each batch (see V8IsolateExecutor) and the embedder may call at any time.
+ */
+#ifndef V8_BINDING_EXTERNAL_MEMORY_BATCH
+#define V8_BINDING_EXTERNAL_MEMORY_BATCH (1 << 20)
+#endif
+
+class V8ExternalMemory
+{
+public:
+    static void adjust(v8::Isolate *isolate, int64_t delta)
+    {
+        auto &pending = local();
+        if (pending.isolate != isolate)
+        {
+            flush();
+            pending.isolate = isolate;
+        }
+        pending.delta += delta;
+        if (pending.delta >= V8_BINDING_EXTERNAL_MEMORY_BATCH || pending.delta <= -V8_BINDING_EXTERNAL_MEMORY_BATCH)
+        {
+            flush();
+        }
+    }
+
+    static void flush()
+    {
+        auto &pending = local();
+        if (pending.isolate != nullptr && pending.delta != 0)
+        {
+            pending.isolate->AdjustAmountOfExternalAllocatedMemory(pending.delta);
+        }
+        pending.delta = 0;
+    }
+
+    /** Drop the pending delta of an isolate being disposed */
+    static void discard(v8::Isolate *isolate)
+    {
+        auto &pending = local();
+        if (pending.isolate == isolate)
+        {
+            pending.isolate = nullptr;
+            pending.delta = 0;
+        }
+    }
+
+private:
+    struct Pending
+    {
+        v8::Isolate *isolate{ nullptr };
+        int64_t delta{ 0 };
+    };
+
+    static Pending &local()
+    {
+        static thread_local Pending pending;
+        return pending;
+    }
+};
+
+/**
+ * Per-isolate table of the weak handles of wrapped objects. Slots are allocated in fixed chunks,
+ * so a handle never moves and is addressed by the 32-bit index kept in the object header;
+ * released slots go to a free list. The objects still alive when the isolate data is disposed
+ * are finalized in bulk, since V8 does not run weak callbacks at teardown.
+ */
+class V8HandleTable
+{
+public:
+    using Finalizer = void (*)(v8::Isolate *, void *);
+
+    static constexpr uint32_t CHUNK_SIZE = 4096;
+    static constexpr uint32_t NONE = 0xffffffffu;
+
+    V8HandleTable() {}
+
+    V8HandleTable(const V8HandleTable &) = delete;
+
+    V8HandleTable &operator=(const V8HandleTable &) = delete;
+
+    uint32_t acquire(void *object, Finalizer finalizer)
+    {
+        if (freeHead == NONE)
+        {
+            grow();
+        }
+        auto index = freeHead;
+        auto &slot = at(index);
+        freeHead = slot.next;
+        slot.object = object;
+        slot.finalizer = finalizer;
+        ++count;
+        return index;
+    }
+
+    v8::Global<v8::Object> &handle(uint32_t index)
+    {
+        return at(index).handle;
+    }
+
+    void release(uint32_t index)
+    {
+        auto &slot = at(index);
+        slot.handle.Reset();
+        slot.object = nullptr;
+        slot.finalizer = nullptr;
+        slot.next = freeHead;
+        freeHead = index;
+        --count;
+    }
+
+    size_t size() const
+    {
+        return count;
+    }
+
+    void dispose(v8::Isolate *isolate)
+    {
+        for (auto &chunk : chunks)
+        {
+            for (uint32_t i = 0; i < CHUNK_SIZE; ++i)
+            {
+                auto &slot = chunk[i];
+                if (slot.object != nullptr)
+                {
+                    slot.handle.Reset();
+                    slot.finalizer(isolate, slot.object);
+                    slot.object = nullptr;
+                }
+            }
+        }
+        chunks.clear();
+        freeHead = NONE;
+        count = 0;
+    }
+
+private:
+    struct Slot
+    {
+        v8::Global<v8::Object> handle;
+        void *object{ nullptr };
+        Finalizer finalizer{ nullptr };
+        uint32_t next{ NONE };
+    };
+
+    Slot &at(uint32_t index)
+    {
+        return chunks[index / CHUNK_SIZE][index % CHUNK_SIZE];
+    }
+
+    void grow()
+    {
+        auto base = static_cast<uint32_t>(chunks.size()) * CHUNK_SIZE;
+        chunks.emplace_back(new Slot[CHUNK_SIZE]);
+        auto chunk = chunks.back().get();
+        for (uint32_t i = CHUNK_SIZE; i-- > 0;)
+        {
+            chunk[i].next = freeHead;
+            freeHead = base + i;
+        }
+    }
+
+    std::vector<std::unique_ptr<Slot[]>> chunks;
+    uint32_t freeHead{ NONE };
+    size_t count{ 0 };
+};
+
+/**
+ * Per-isolate identity map from a native object (address, type and kind of holder) to its JS wrapper,
+ * so returning the same object twice gives the same JS object. The holder kind keeps a wrapper
+ * holding the object by pointer apart from one sharing its ownership. Entries are weak and
+ * removed by the weak callback when the wrapper is collected.
+ */
+class V8WrapperCache
+{
+public:
+    V8WrapperCache() {}
+
+    V8WrapperCache(const V8WrapperCache &) = delete;
+
+    V8WrapperCache &operator=(const V8WrapperCache &) = delete;
+
+    v8::Local<v8::Object> get(v8::Isolate *isolate, const void *ptr, const void *type, int kind) const
+    {
+        auto it = entries.find(Key{ ptr, type, kind });
+        return it == entries.end() ? v8::Local<v8::Object>() : it->second->handle.Get(isolate);
+    }
+
+    void set(v8::Isolate *isolate, const void *ptr, const void *type, int kind, v8::Local<v8::Object> object)
+    {
+        Key key{ ptr, type, kind };
+        auto &entry = entries[key];
+        entry.reset(new Entry{ this, key, v8::Global<v8::Object>(isolate, object) });
+        entry->handle.SetWeak(entry.get(), &collected, v8::WeakCallbackType::kParameter);
+    }
+
+    size_t size() const
+    {
+        return entries.size();
+    }
+
+private:
+    struct Key
+    {
+        const void *ptr;
+        const void *type;
+        int kind;
+
+        bool operator==(const Key &other) const
+        {
+            return ptr == other.ptr && type == other.type && kind == other.kind;
+        }
+    };
+
+    struct KeyHash
+    {
+        size_t operator()(const Key &key) const
+        {
+            return std::hash<const void *>()(key.ptr) ^ (std::hash<const void *>()(key.type) << 1) ^ static_cast<size_t>(key.kind);
+        }
+    };
+
+    struct Entry
+    {
+        V8WrapperCache *cache;
+        Key key;
+        v8::Global<v8::Object> handle;
+    };
+
+    static void collected(const v8::WeakCallbackInfo<Entry> &data)
+    {
+        auto entry = data.GetParameter();
+        auto key = entry->key;
+        entry->cache->entries.erase(key);
+    }
+
+    std::unordered_map<Key, std::unique_ptr<Entry>, KeyHash> entries;
+};
+
+/**
+ * Binding state attached to an isolate through data slot V8_BINDING_ISOLATE_SLOT.
+ * It is created on first use, and must be released by calling dispose before the isolate is disposed,
+ * on the isolate thread with the isolate entered. Disposing waits for the async jobs still running
+ * and settles them (see V8CompletionQueue::finish), finalizes the objects still wrapped at that point
+ * (see V8HandleTable), then releases the slab pool in bulk.
+ */
+class V8IsolateData
+{
+public:
+    static V8IsolateData &get(v8::Isolate *isolate)
+    {
+        auto data = static_cast<V8IsolateData *>(isolate->GetData(V8_BINDING_ISOLATE_SLOT));
+        if (data == nullptr)
+        {
+            data = new V8IsolateData;
+            isolate->SetData(V8_BINDING_ISOLATE_SLOT, data);
+        }
+        return *data;
+    }
+
+    static V8IsolateData &get()
+    {
+        return get(v8::Isolate::GetCurrent());
+    }
+
+    static void dispose(v8::Isolate *isolate)
+    {
+        auto data = static_cast<V8IsolateData *>(isolate->GetData(V8_BINDING_ISOLATE_SLOT));
+        if (data != nullptr)
+        {
+            data->completions->finish();
+            data->handles.dispose(isolate);
+        }
+        V8ExternalMemory::discard(isolate);
+        delete data;
+        isolate->SetData(V8_BINDING_ISOLATE_SLOT, nullptr);
+    }
+
+    V8IsolateData(const V8IsolateData &) = delete;
+
+    V8IsolateData &operator=(const V8IsolateData &) = delete;
+
+    /**
+     * Keep an object alive until the isolate data is disposed, used for the binding data
+     * (e.g. bound function objects) referenced through v8::External by function templates.
+     */
+    template<typename T>
+    T *retain(T *ptr)
+    {
+        retained.emplace_back(ptr, [](void *p) { delete static_cast<T *>(p); });
+        return ptr;
+    }
+
+    V8KeyTable keys;
+
+    V8TemplateTable templates;
+
+    std::shared_ptr<V8CompletionQueue> completions;
+
+    V8SlabPool slabs;
+
+    V8HandleTable handles;
+
+    V8WrapperCache wrappers;
+
+private:
+    V8IsolateData() : completions(std::make_shared<V8CompletionQueue>()) {}
+
+    std::vector<std::unique_ptr<void, void(*)(void *)>> retained;
+};
+
+/**
+ * Get the internalized key for a binding name in the current isolate.
+ */
+inline v8::Local<v8::String> V8Key(const char *name)
+{
+    auto isolate = v8::Isolate::GetCurrent();
+    return V8IsolateData::get(isolate).keys.get(isolate, name);
+}
+
+#define V8_KEY(name) V8IsolateData::get().keys.get(v8::Isolate::GetCurrent(), name, std::integral_constant<uint32_t, V8KeyHash(name)>::value)
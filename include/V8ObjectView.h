@@ -0,0 +1,221 @@
+#pragma once
+
+#include "V8Isolate.h"
+#include "V8Type.h"
+
+#include <v8.h>
+
+/**
+ * Lazy view of a JS object received as an argument. Only the handle is kept,
+ * fields are converted when C++ asks for them, e.g. view.get<double>("x").
+ * Field names given as const char * are created as plain strings on each access, use V8_KEY("x")
+ * (or any v8::Local<v8::Name>) for literal names to reuse the internalized key of the isolate.
+ * The view is valid within the handle scope it was created in (e.g. the bound function call).
+ */
+class V8ObjectView
+{
+public:
+    V8ObjectView() {}
+
+    explicit V8ObjectView(v8::Local<v8::Object> object) : object(object) {}
+
+    bool isEmpty() const
+    {
+        return object.IsEmpty();
+    }
+
+    v8::Local<v8::Object> handle() const
+    {
+        return object;
+    }
+
+    bool has(v8::Local<v8::Name> key) const
+    {
+        return !object.IsEmpty() && object->Has(v8::Isolate::GetCurrent()->GetCurrentContext(), key).FromMaybe(false);
+    }
+
+    bool has(const char *key) const
+    {
+        return has(name(key));
+    }
+
+    v8::Local<v8::Value> raw(v8::Local<v8::Name> key) const
+    {
+        if (object.IsEmpty())
+        {
+            return v8::Undefined(v8::Isolate::GetCurrent());
+        }
+        return object->Get(v8::Isolate::GetCurrent()->GetCurrentContext(), key).FromMaybe(v8::Local<v8::Value>(v8::Undefined(v8::Isolate::GetCurrent())));
+    }
+
+    v8::Local<v8::Value> raw(const char *key) const
+    {
+        return raw(name(key));
+    }
+
+    template<typename T>
+    T get(v8::Local<v8::Name> key) const
+    {
+        return V8Type<T>::get(raw(key));
+    }
+
+    template<typename T>
+    T get(const char *key) const
+    {
+        return get<T>(name(key));
+    }
+
+    template<typename T>
+    T opt(v8::Local<v8::Name> key, const T &def) const
+    {
+        return V8Type<T>::opt(raw(key), def);
+    }
+
+    template<typename T>
+    T opt(const char *key, const T &def) const
+    {
+        return opt<T>(name(key), def);
+    }
+
+    template<typename T>
+    void set(v8::Local<v8::Name> key, const T &value) const
+    {
+        object->Set(v8::Isolate::GetCurrent()->GetCurrentContext(), key, V8Type<T>::set(value)).FromJust();
+    }
+
+    template<typename T>
+    void set(const char *key, const T &value) const
+    {
+        set<T>(name(key), value);
+    }
+
+private:
+    static v8::Local<v8::String> name(const char *key)
+    {
+        return v8::String::NewFromUtf8(v8::Isolate::GetCurrent(), key, v8::NewStringType::kNormal).ToLocalChecked();
+    }
+
+    v8::Local<v8::Object> object;
+};
+
+/**
+ * Lazy view of a JS array received as an argument, elements are converted on access.
+ */
+class V8ArrayView
+{
+public:
+    V8ArrayView() {}
+
+    explicit V8ArrayView(v8::Local<v8::Array> array) : array(array) {}
+
+    bool isEmpty() const
+    {
+        return array.IsEmpty();
+    }
+
+    v8::Local<v8::Array> handle() const
+    {
+        return array;
+    }
+
+    uint32_t size() const
+    {
+        return array.IsEmpty() ? 0 : array->Length();
+    }
+
+    v8::Local<v8::Value> raw(uint32_t index) const
+    {
+        if (index >= size())
+        {
+            return v8::Undefined(v8::Isolate::GetCurrent());
+        }
+        return array->Get(v8::Isolate::GetCurrent()->GetCurrentContext(), index).FromMaybe(v8::Local<v8::Value>(v8::Undefined(v8::Isolate::GetCurrent())));
+    }
+
+    template<typename T>
+    T get(uint32_t index) const
+    {
+        return V8Type<T>::get(raw(index));
+    }
+
+    template<typename T>
+    T opt(uint32_t index, const T &def) const
+    {
+        return V8Type<T>::opt(raw(index), def);
+    }
+
+    template<typename T>
+    void set(uint32_t index, const T &value) const
+    {
+        array->Set(v8::Isolate::GetCurrent()->GetCurrentContext(), index, V8Type<T>::set(value)).FromJust();
+    }
+
+private:
+    v8::Local<v8::Array> array;
+};
+
+template<>
+struct V8TypeIsView<V8ObjectView>
+    : std::true_type {};
+
+template<>
+struct V8TypeIsView<V8ArrayView>
+    : std::true_type {};
+
+template<>
+struct V8TypeMapping<V8ObjectView>
+{
+    static v8::Local<v8::Value> set(const V8ObjectView &view)
+    {
+        if (view.isEmpty())
+        {
+            return v8::Undefined(v8::Isolate::GetCurrent());
+        }
+        return view.handle();
+    }
+
+    static V8ObjectView get(v8::MaybeLocal<v8::Value> handle)
+    {
+        auto value = handle.ToLocalChecked();
+        if (!value->IsObject())
+        {
+            v8::Isolate::GetCurrent()->ThrowException(v8::Exception::TypeError(v8::String::NewFromUtf8(v8::Isolate::GetCurrent(), "except object", v8::NewStringType::kNormal).ToLocalChecked()));
+            return V8ObjectView();
+        }
+        return V8ObjectView(value.As<v8::Object>());
+    }
+
+    static V8ObjectView opt(v8::MaybeLocal<v8::Value> handle, const V8ObjectView &def)
+    {
+        return handle.ToLocalChecked()->IsUndefined() ? def : get(handle);
+    }
+};
+
+template<>
+struct V8TypeMapping<V8ArrayView>
+{
+    static v8::Local<v8::Value> set(const V8ArrayView &view)
+    {
+        if (view.isEmpty())
+        {
+            return v8::Undefined(v8::Isolate::GetCurrent());
+        }
+        return view.handle();
+    }
+
+    static V8ArrayView get(v8::MaybeLocal<v8::Value> handle)
+    {
+        auto value = handle.ToLocalChecked();
+        if (!value->IsArray())
+        {
+            v8::Isolate::GetCurrent()->ThrowException(v8::Exception::TypeError(v8::String::NewFromUtf8(v8::Isolate::GetCurrent(), "except array", v8::NewStringType::kNormal).ToLocalChecked()));
+            return V8ArrayView();
+        }
+        return V8ArrayView(value.As<v8::Array>());
+    }
+
+    static V8ArrayView opt(v8::MaybeLocal<v8::Value> handle, const V8ArrayView &def)
+    {
+        return handle.ToLocalChecked()->IsUndefined() ? def : get(handle);
+    }
+};
@@ -3,11 +3,29 @@
 #include <v8.h>
 
 #include <cassert>
+#include <cstring>
+#include <limits>
 #include <type_traits>
 #include <string>
 #include <vector>
 #include <map>
+#include <memory>
+#include <set>
 #include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+
+#if V8_MAJOR_VERSION > 6 || (V8_MAJOR_VERSION == 6 && V8_MINOR_VERSION >= 7)
+#define V8_HAS_BIGINT 1
+#else
+#define V8_HAS_BIGINT 0
+#endif
+
+#if V8_MAJOR_VERSION > 7 || (V8_MAJOR_VERSION == 7 && V8_MINOR_VERSION >= 8)
+#define V8_HAS_BULK_NEW 1
+#else
+#define V8_HAS_BULK_NEW 0
+#endif
 
 template<typename T, typename ENABLED = void>
 struct V8TypeMapping;
@@ -31,6 +49,18 @@ struct V8TypeMappingExists
     static constexpr bool value = Type::value;
 };
 
+/**
+ * Whether T refers to memory or handles owned by V8 (views, Local handles), so it is only valid
+ * on the isolate thread for the duration of a call. Specialized next to each view type.
+ */
+template<typename T>
+struct V8TypeIsView
+    : std::false_type {};
+
+template<typename T>
+struct V8TypeIsView<v8::Local<T>>
+    : std::true_type {};
+
 template<typename T>
 struct V8Type
     : std::conditional<
@@ -47,38 +77,46 @@ struct V8TypeMapping<bool>
 {
     static v8::Local<v8::Boolean> set(bool value)
     {
-        v8::EscapableHandleScope scope(v8::Isolate::GetCurrent());
-        return scope.Escape(v8::Boolean::New(v8::Isolate::GetCurrent(), value));
+        return v8::Boolean::New(v8::Isolate::GetCurrent(), value);
     }
 
     static bool get(v8::MaybeLocal<v8::Value> handle)
     {
-        return handle.ToLocalChecked()->ToBoolean()->Value();
+        auto value = handle.ToLocalChecked();
+        if (value->IsBoolean())
+        {
+            return value.As<v8::Boolean>()->Value();
+        }
+        return value->BooleanValue(v8::Isolate::GetCurrent());
     }
 
     static bool opt(v8::MaybeLocal<v8::Value> handle, bool def)
     {
-        return handle.ToLocalChecked()->IsUndefined() ? def : handle.ToLocalChecked()->ToBoolean()->Value();
+        return handle.ToLocalChecked()->IsUndefined() ? def : get(handle);
     }
 };
 
 template<typename T>
 struct V8Int32TypeMapping
 {
-    static v8::Local<v8::Int32> set(T value)
+    static v8::Local<v8::Integer> set(T value)
     {
-        v8::EscapableHandleScope scope(v8::Isolate::GetCurrent());
-        return scope.Escape(v8::Int32::New(v8::Isolate::GetCurrent(), value));
+        return v8::Integer::New(v8::Isolate::GetCurrent(), static_cast<int32_t>(value));
     }
 
     static T get(v8::MaybeLocal<v8::Value> handle)
     {
-        return static_cast<T>(handle.ToLocalChecked()->ToInt32()->Value());
+        auto value = handle.ToLocalChecked();
+        if (value->IsInt32())
+        {
+            return static_cast<T>(value.As<v8::Int32>()->Value());
+        }
+        return static_cast<T>(value->Int32Value(v8::Isolate::GetCurrent()->GetCurrentContext()).FromMaybe(0));
     }
 
     static T opt(v8::MaybeLocal<v8::Value> handle, T def)
     {
-        return handle.ToLocalChecked()->IsUndefined() ? def : static_cast<T>(handle.ToLocalChecked()->ToInt32()->Value());
+        return handle.ToLocalChecked()->IsUndefined() ? def : get(handle);
     }
 };
 
@@ -94,27 +132,28 @@ template<>
 struct V8TypeMapping<int>
     : V8Int32TypeMapping<int> {};
 
-template<>
-struct V8TypeMapping<long>
-    : V8Int32TypeMapping<long> {};
 
 template<typename T>
 struct V8Uint32TypeMapping
 {
-    static v8::Local<v8::Uint32> set(T value)
+    static v8::Local<v8::Integer> set(T value)
     {
-        v8::EscapableHandleScope scope(v8::Isolate::GetCurrent());
-        return scope.Escape(v8::Uint32::New(v8::Isolate::GetCurrent(), value));
+        return v8::Integer::NewFromUnsigned(v8::Isolate::GetCurrent(), static_cast<uint32_t>(value));
     }
 
     static T get(v8::MaybeLocal<v8::Value> handle)
     {
-        return static_cast<T>(handle.ToLocalChecked()->ToUint32()->Value());
+        auto value = handle.ToLocalChecked();
+        if (value->IsUint32())
+        {
+            return static_cast<T>(value.As<v8::Uint32>()->Value());
+        }
+        return static_cast<T>(value->Uint32Value(v8::Isolate::GetCurrent()->GetCurrentContext()).FromMaybe(0));
     }
 
     static T opt(v8::MaybeLocal<v8::Value> handle, T def)
     {
-        return handle.ToLocalChecked()->IsUndefined() ? def : static_cast<T>(handle.ToLocalChecked()->ToUint32()->Value());
+        return handle.ToLocalChecked()->IsUndefined() ? def : get(handle);
     }
 };
 
@@ -130,58 +169,195 @@ template<>
 struct V8TypeMapping<unsigned int>
     : V8Uint32TypeMapping<unsigned int> {};
 
-template<>
-struct V8TypeMapping<unsigned long>
-    : V8Uint32TypeMapping<unsigned long> {};
+
+/**
+ * Representation policies for 64-bit integers:
+ * V8Int64AsNumber always uses Number (exact up to 2^53), V8Int64AsBigInt always uses BigInt,
+ * and V8Int64Auto uses Number when the value is exact as a double and BigInt otherwise.
+ * All policies accept both Number and BigInt when reading. Without BigInt support in V8,
+ * every policy falls back to Number.
+ */
+struct V8Int64AsNumber {};
+
+struct V8Int64AsBigInt {};
+
+struct V8Int64Auto {};
+
+#ifndef V8_BINDING_INT64_POLICY
+#define V8_BINDING_INT64_POLICY V8Int64Auto
+#endif
+
+template<typename T, typename POLICY>
+struct V8Int64Policy;
 
 template<typename T>
-struct V8IntegerTypeMapping
+struct V8Int64Policy<T, V8Int64AsNumber>
 {
-    static v8::Local<v8::Integer> set(T value)
+    static v8::Local<v8::Value> set(T value)
     {
-        v8::EscapableHandleScope scope(v8::Isolate::GetCurrent());
-        return scope.Escape(v8::Integer::New(v8::Isolate::GetCurrent(), value));
+        return v8::Number::New(v8::Isolate::GetCurrent(), static_cast<double>(value));
+    }
+};
+
+template<typename T>
+struct V8Int64Policy<T, V8Int64AsBigInt>
+{
+    static v8::Local<v8::Value> set(T value)
+    {
+#if V8_HAS_BIGINT
+        if (std::is_signed<T>::value)
+        {
+            return v8::BigInt::New(v8::Isolate::GetCurrent(), static_cast<int64_t>(value));
+        }
+        else
+        {
+            return v8::BigInt::NewFromUnsigned(v8::Isolate::GetCurrent(), static_cast<uint64_t>(value));
+        }
+#else
+        return V8Int64Policy<T, V8Int64AsNumber>::set(value);
+#endif
+    }
+};
+
+template<typename T>
+struct V8Int64Policy<T, V8Int64Auto>
+{
+    static constexpr T MAX_SAFE = static_cast<T>(9007199254740991LL);
+
+    static v8::Local<v8::Value> set(T value)
+    {
+        if (value <= MAX_SAFE && (!std::is_signed<T>::value || value >= -MAX_SAFE))
+        {
+            return V8Int64Policy<T, V8Int64AsNumber>::set(value);
+        }
+        else
+        {
+            return V8Int64Policy<T, V8Int64AsBigInt>::set(value);
+        }
+    }
+};
+
+template<typename T, typename POLICY = V8_BINDING_INT64_POLICY>
+struct V8Int64TypeMapping
+{
+    static v8::Local<v8::Value> set(T value)
+    {
+        return V8Int64Policy<T, POLICY>::set(value);
     }
 
     static T get(v8::MaybeLocal<v8::Value> handle)
     {
-        return static_cast<T>(handle.ToLocalChecked()->ToInteger()->Value());
+        auto value = handle.ToLocalChecked();
+        if (value->IsInt32())
+        {
+            return static_cast<T>(value.As<v8::Int32>()->Value());
+        }
+#if V8_HAS_BIGINT
+        if (value->IsBigInt())
+        {
+            if (std::is_signed<T>::value)
+            {
+                return static_cast<T>(value.As<v8::BigInt>()->Int64Value());
+            }
+            else
+            {
+                return static_cast<T>(value.As<v8::BigInt>()->Uint64Value());
+            }
+        }
+#endif
+        double number = value->IsNumber()
+            ? value.As<v8::Number>()->Value()
+            : value->NumberValue(v8::Isolate::GetCurrent()->GetCurrentContext()).FromMaybe(0);
+        return fromNumber(number);
     }
 
     static T opt(v8::MaybeLocal<v8::Value> handle, T def)
     {
-        return handle.ToLocalChecked()->IsUndefined() ? def : static_cast<T>(handle.ToLocalChecked()->ToInteger()->Value());
+        return handle.ToLocalChecked()->IsUndefined() ? def : get(handle);
+    }
+
+    /**
+     * Truncate a number towards zero, NaN becomes 0 and values out of the range of T
+     * (including infinities) saturate to its limits instead of being undefined behavior.
+     */
+    static T fromNumber(double number)
+    {
+        if (number != number)
+        {
+            return 0;
+        }
+        const double low = std::is_signed<T>::value ? -9223372036854775808.0 : 0.0;
+        const double high = std::is_signed<T>::value ? 9223372036854775808.0 : 18446744073709551616.0;
+        if (number <= low)
+        {
+            return std::numeric_limits<T>::min();
+        }
+        if (number >= high)
+        {
+            return std::numeric_limits<T>::max();
+        }
+        return static_cast<T>(number);
     }
 };
 
 template<>
-struct V8TypeMapping<long long>
-    : V8IntegerTypeMapping<long long> {};
+struct V8TypeMapping<long>
+    : std::conditional<sizeof(long) == sizeof(int64_t), V8Int64TypeMapping<long>, V8Int32TypeMapping<long>>::type {};
 
-template<typename T>
-using V8UnsignedIntegerTypeMapping = V8IntegerTypeMapping<T>;
+template<>
+struct V8TypeMapping<unsigned long>
+    : std::conditional<sizeof(unsigned long) == sizeof(uint64_t), V8Int64TypeMapping<unsigned long>, V8Uint32TypeMapping<unsigned long>>::type {};
+
+template<>
+struct V8TypeMapping<long long>
+    : V8Int64TypeMapping<long long> {};
 
 template<>
 struct V8TypeMapping<unsigned long long>
-    : V8UnsignedIntegerTypeMapping<unsigned long long> {};
+    : V8Int64TypeMapping<unsigned long long> {};
+
+/**
+ * Pick the 64-bit integer representation for a single binding, e.g.
+ * V8_ARGS(V8Int64<int64_t, V8Int64AsBigInt>) or as the return type of a bound function.
+ */
+template<typename T, typename POLICY>
+struct V8Int64
+{
+    V8Int64(T value = 0) : value(value) {}
+
+    operator T() const
+    {
+        return value;
+    }
+
+    T value;
+};
+
+template<typename T, typename POLICY>
+struct V8TypeMapping<V8Int64<T, POLICY>>
+    : V8Int64TypeMapping<T, POLICY> {};
 
 template<typename T>
 struct V8NumberTypeMapping
 {
     static v8::Local<v8::Number> set(T value)
     {
-        v8::EscapableHandleScope scope(v8::Isolate::GetCurrent());
-        return scope.Escape(v8::Number::New(v8::Isolate::GetCurrent(), value));
+        return v8::Number::New(v8::Isolate::GetCurrent(), static_cast<double>(value));
     }
 
     static T get(v8::MaybeLocal<v8::Value> handle)
     {
-        return static_cast<T>(handle.ToLocalChecked()->ToNumber()->Value());
+        auto value = handle.ToLocalChecked();
+        if (value->IsNumber())
+        {
+            return static_cast<T>(value.As<v8::Number>()->Value());
+        }
+        return static_cast<T>(value->NumberValue(v8::Isolate::GetCurrent()->GetCurrentContext()).FromMaybe(0));
     }
 
     static T opt(v8::MaybeLocal<v8::Value> handle, T def)
     {
-        return handle.ToLocalChecked()->IsUndefined() ? def : static_cast<T>(handle.ToLocalChecked()->ToNumber()->Value());
+        return handle.ToLocalChecked()->IsUndefined() ? def : get(handle);
     }
 };
 
@@ -193,51 +369,315 @@ template<>
 struct V8TypeMapping<double>
     : V8NumberTypeMapping<double> {};
 
+template<typename T, template<typename> class MAPPING, bool IS_ARITHMETIC = std::is_arithmetic<T>::value>
+struct V8IsMappedBy
+    : std::false_type {};
+
+template<typename T, template<typename> class MAPPING>
+struct V8IsMappedBy<T, MAPPING, true>
+    : std::is_base_of<MAPPING<T>, V8TypeMapping<T>> {};
+
+/**
+ * Write a converted value into a ReturnValue. Primitives mapped to Boolean, Int32, Uint32 or Number
+ * are written with the ReturnValue::Set overloads for primitives, which do not create a handle;
+ * the choice is made at compile time from the return type.
+ */
+template<typename T, typename ENABLED = void>
+struct V8ReturnValue
+{
+    template<typename V>
+    static void set(v8::ReturnValue<v8::Value> ret, V &&value)
+    {
+        ret.Set(V8Type<T>::set(std::forward<V>(value)));
+    }
+};
+
+template<typename T>
+struct V8ReturnValue<T,
+    typename std::enable_if<std::is_same<typename std::decay<T>::type, bool>::value>::type>
+{
+    static void set(v8::ReturnValue<v8::Value> ret, bool value)
+    {
+        ret.Set(value);
+    }
+};
+
+template<typename T>
+struct V8ReturnValue<T,
+    typename std::enable_if<V8IsMappedBy<typename std::decay<T>::type, V8Int32TypeMapping>::value>::type>
+{
+    static void set(v8::ReturnValue<v8::Value> ret, typename std::decay<T>::type value)
+    {
+        ret.Set(static_cast<int32_t>(value));
+    }
+};
+
+template<typename T>
+struct V8ReturnValue<T,
+    typename std::enable_if<V8IsMappedBy<typename std::decay<T>::type, V8Uint32TypeMapping>::value>::type>
+{
+    static void set(v8::ReturnValue<v8::Value> ret, typename std::decay<T>::type value)
+    {
+        ret.Set(static_cast<uint32_t>(value));
+    }
+};
+
+template<typename T>
+struct V8ReturnValue<T,
+    typename std::enable_if<V8IsMappedBy<typename std::decay<T>::type, V8NumberTypeMapping>::value>::type>
+{
+    static void set(v8::ReturnValue<v8::Value> ret, typename std::decay<T>::type value)
+    {
+        ret.Set(static_cast<double>(value));
+    }
+};
+
+/**
+ * String conversion helpers shared by the string type mappings.
+ * One-byte strings are copied with WriteOneByte and only transcoded when they contain
+ * Latin-1 characters, and ASCII data is created with NewFromOneByte using explicit lengths.
+ */
+struct V8StringConverter
+{
+    static bool isAscii(const char *data, size_t length)
+    {
+        unsigned char bits = 0;
+        for (size_t i = 0; i < length; ++i)
+        {
+            bits |= static_cast<unsigned char>(data[i]);
+        }
+        return bits < 0x80;
+    }
+
+    /**
+     * Per-thread scratch buffer of the storage-less string conversions.
+     */
+    static std::string &localBuffer()
+    {
+        static thread_local std::string buffer;
+        return buffer;
+    }
+
+    /**
+     * Write the string as UTF-8 into the caller-provided buffer, replacing its content.
+     */
+    static void write(v8::Local<v8::String> str, std::string &buffer)
+    {
+        auto isolate = v8::Isolate::GetCurrent();
+        if (str->IsOneByte())
+        {
+            auto length = static_cast<size_t>(str->Length());
+            buffer.resize(length);
+            if (length == 0)
+            {
+                return;
+            }
+            str->WriteOneByte(isolate, reinterpret_cast<uint8_t *>(&buffer[0]), 0, static_cast<int>(length), v8::String::NO_NULL_TERMINATION);
+            size_t extra = 0;
+            for (size_t i = 0; i < length; ++i)
+            {
+                extra += static_cast<unsigned char>(buffer[i]) >> 7;
+            }
+            if (extra > 0)
+            {
+                buffer.resize(length + extra);
+                auto out = length + extra;
+                for (auto in = length; in > 0; --in)
+                {
+                    auto c = static_cast<unsigned char>(buffer[in - 1]);
+                    if (c < 0x80)
+                    {
+                        buffer[--out] = static_cast<char>(c);
+                    }
+                    else
+                    {
+                        buffer[--out] = static_cast<char>(0x80 | (c & 0x3F));
+                        buffer[--out] = static_cast<char>(0xC0 | (c >> 6));
+                    }
+                }
+            }
+        }
+        else
+        {
+            buffer.resize(static_cast<size_t>(str->Utf8Length(isolate)));
+            if (!buffer.empty())
+            {
+                str->WriteUtf8(isolate, &buffer[0], static_cast<int>(buffer.size()), nullptr, v8::String::NO_NULL_TERMINATION);
+            }
+        }
+    }
+
+    /**
+     * Convert a value with ToString in the current context and write it into the buffer.
+     * If the conversion throws, the buffer is cleared and the exception is left pending.
+     */
+    template<typename STRING>
+    static void read(v8::Local<v8::Value> value, STRING &buffer)
+    {
+        v8::Local<v8::String> str;
+        if (value->ToString(v8::Isolate::GetCurrent()->GetCurrentContext()).ToLocal(&str))
+        {
+            write(str, buffer);
+        }
+        else
+        {
+            buffer.clear();
+        }
+    }
+
+    static void write(v8::Local<v8::String> str, std::u16string &buffer)
+    {
+        buffer.resize(static_cast<size_t>(str->Length()));
+        if (!buffer.empty())
+        {
+            str->Write(v8::Isolate::GetCurrent(), reinterpret_cast<uint16_t *>(&buffer[0]), 0, static_cast<int>(buffer.size()), v8::String::NO_NULL_TERMINATION);
+        }
+    }
+
+    static v8::Local<v8::String> create(const char *data, size_t length)
+    {
+        v8::EscapableHandleScope scope(v8::Isolate::GetCurrent());
+        if (isAscii(data, length))
+        {
+            return scope.Escape(v8::String::NewFromOneByte(v8::Isolate::GetCurrent(), reinterpret_cast<const uint8_t *>(data), v8::NewStringType::kNormal, static_cast<int>(length)).ToLocalChecked());
+        }
+        else
+        {
+            return scope.Escape(v8::String::NewFromUtf8(v8::Isolate::GetCurrent(), data, v8::NewStringType::kNormal, static_cast<int>(length)).ToLocalChecked());
+        }
+    }
+
+    static std::u16string toUtf16(const char *data, size_t length)
+    {
+        std::u16string out;
+        out.reserve(length);
+        for (size_t i = 0; i < length;)
+        {
+            auto c = static_cast<unsigned char>(data[i]);
+            uint32_t code;
+            size_t n;
+            if (c < 0x80)
+            {
+                code = c;
+                n = 1;
+            }
+            else if ((c >> 5) == 0x06)
+            {
+                code = c & 0x1F;
+                n = 2;
+            }
+            else if ((c >> 4) == 0x0E)
+            {
+                code = c & 0x0F;
+                n = 3;
+            }
+            else if ((c >> 3) == 0x1E)
+            {
+                code = c & 0x07;
+                n = 4;
+            }
+            else
+            {
+                code = 0xFFFD;
+                n = 1;
+            }
+            if (i + n > length)
+            {
+                code = 0xFFFD;
+                n = length - i;
+            }
+            else
+            {
+                for (size_t k = 1; k < n; ++k)
+                {
+                    code = (code << 6) | (static_cast<unsigned char>(data[i + k]) & 0x3F);
+                }
+            }
+            i += n;
+            if (code >= 0x10000)
+            {
+                code -= 0x10000;
+                out.push_back(static_cast<char16_t>(0xD800 + (code >> 10)));
+                out.push_back(static_cast<char16_t>(0xDC00 + (code & 0x3FF)));
+            }
+            else
+            {
+                out.push_back(static_cast<char16_t>(code));
+            }
+        }
+        return out;
+    }
+
+    static v8::Local<v8::String> create(const char16_t *data, size_t length)
+    {
+        v8::EscapableHandleScope scope(v8::Isolate::GetCurrent());
+        return scope.Escape(v8::String::NewFromTwoByte(v8::Isolate::GetCurrent(), reinterpret_cast<const uint16_t *>(data), v8::NewStringType::kNormal, static_cast<int>(length)).ToLocalChecked());
+    }
+};
+
 template<>
 struct V8TypeMapping<char>
 {
     static v8::Local<v8::String> set(char value)
     {
-        char str[] = { value, 0 };
-        v8::EscapableHandleScope scope(v8::Isolate::GetCurrent());
-        return scope.Escape(v8::String::NewFromUtf8(v8::Isolate::GetCurrent(), str));
+        return V8StringConverter::create(&value, 1);
     }
 
     static char get(v8::MaybeLocal<v8::Value> handle)
     {
-        return (*v8::String::Utf8Value(handle.ToLocalChecked()->ToString()))[0];
+        v8::HandleScope scope(v8::Isolate::GetCurrent());
+        std::string str;
+        V8StringConverter::read(handle.ToLocalChecked(), str);
+        return str.empty() ? 0 : str[0];
     }
 
     static char opt(v8::MaybeLocal<v8::Value> handle, char def)
     {
-        return handle.ToLocalChecked()->IsUndefined() ? def : (*v8::String::Utf8Value(handle.ToLocalChecked()->ToString()))[0];
+        return handle.ToLocalChecked()->IsUndefined() ? def : get(handle);
     }
 };
 
+/**
+ * get decodes into the storage given by the caller and returns a pointer into it,
+ * bound function arguments use the storage of their argument holder.
+ * Without storage, the result points into a per-thread buffer and is only valid until
+ * the next such conversion on this thread (e.g. V8Function<const char *()> results).
+ */
 template<>
 struct V8TypeMapping<const char *>
 {
     static v8::Local<v8::String> set(const char *str)
     {
-        v8::EscapableHandleScope scope(v8::Isolate::GetCurrent());
         if (str == nullptr)
         {
-            return scope.Escape(v8::String::NewFromUtf8(v8::Isolate::GetCurrent(), "<string from nullptr>"));
+            return V8StringConverter::create("<string from nullptr>", 21);
         }
         else
         {
-            return scope.Escape(v8::String::NewFromUtf8(v8::Isolate::GetCurrent(), str));
+            return V8StringConverter::create(str, strlen(str));
         }
     }
 
+    static const char *get(v8::MaybeLocal<v8::Value> handle, std::string &storage)
+    {
+        v8::HandleScope scope(v8::Isolate::GetCurrent());
+        V8StringConverter::read(handle.ToLocalChecked(), storage);
+        return storage.c_str();
+    }
+
+    static const char *opt(v8::MaybeLocal<v8::Value> handle, const char *def, std::string &storage)
+    {
+        return handle.ToLocalChecked()->IsUndefined() ? def : get(handle, storage);
+    }
+
     static const char *get(v8::MaybeLocal<v8::Value> handle)
     {
-        return *v8::String::Utf8Value(handle.ToLocalChecked()->ToString());
+        return get(handle, V8StringConverter::localBuffer());
     }
 
     static const char *opt(v8::MaybeLocal<v8::Value> handle, const char *def)
     {
-        return handle.ToLocalChecked()->IsUndefined() ? def : *v8::String::Utf8Value(handle.ToLocalChecked()->ToString());
+        return opt(handle, def, V8StringConverter::localBuffer());
     }
 };
 
@@ -250,43 +690,157 @@ struct V8TypeMapping<std::string>
 {
     static v8::Local<v8::String> set(const std::string &str)
     {
-        v8::EscapableHandleScope scope(v8::Isolate::GetCurrent());
-        return scope.Escape(v8::String::NewFromUtf8(v8::Isolate::GetCurrent(), str.data()));
+        return V8StringConverter::create(str.data(), str.size());
     }
 
     static std::string get(v8::MaybeLocal<v8::Value> handle)
     {
-        return std::string(*v8::String::Utf8Value(handle.ToLocalChecked()->ToString()));
+        v8::HandleScope scope(v8::Isolate::GetCurrent());
+        std::string str;
+        V8StringConverter::read(handle.ToLocalChecked(), str);
+        return str;
     }
 
     static std::string opt(v8::MaybeLocal<v8::Value> handle, const std::string& def)
     {
-        return handle.ToLocalChecked()->IsUndefined() ? def : std::string(*v8::String::Utf8Value(handle.ToLocalChecked()->ToString()));
+        return handle.ToLocalChecked()->IsUndefined() ? def : get(handle);
+    }
+};
+
+template<>
+struct V8TypeMapping<std::u16string>
+{
+    static v8::Local<v8::String> set(const std::u16string &str)
+    {
+        return V8StringConverter::create(str.data(), str.size());
+    }
+
+    static std::u16string get(v8::MaybeLocal<v8::Value> handle)
+    {
+        v8::HandleScope scope(v8::Isolate::GetCurrent());
+        std::u16string str;
+        V8StringConverter::read(handle.ToLocalChecked(), str);
+        return str;
+    }
+
+    static std::u16string opt(v8::MaybeLocal<v8::Value> handle, const std::u16string& def)
+    {
+        return handle.ToLocalChecked()->IsUndefined() ? def : get(handle);
     }
 };
 
+inline void *V8ArrayBufferData(v8::Local<v8::ArrayBuffer> buffer)
+{
+#if V8_MAJOR_VERSION >= 8
+    return buffer->GetBackingStore()->Data();
+#else
+    return buffer->GetContents().Data();
+#endif
+}
+
+template<size_t SIZE, bool IS_SIGNED, bool IS_FLOAT>
+struct V8TypedArrayKind
+{
+    static constexpr bool exists = false;
+};
+
+#define V8_TYPED_ARRAY_KIND(size, is_signed, is_float, type) \
+    template<> \
+    struct V8TypedArrayKind<size, is_signed, is_float> \
+    { \
+        using ArrayType = v8::type; \
+        static constexpr bool exists = true; \
+        static bool is(v8::Local<v8::Value> value) { return value->Is##type(); } \
+    };
+
+V8_TYPED_ARRAY_KIND(1, true, false, Int8Array)
+V8_TYPED_ARRAY_KIND(1, false, false, Uint8Array)
+V8_TYPED_ARRAY_KIND(2, true, false, Int16Array)
+V8_TYPED_ARRAY_KIND(2, false, false, Uint16Array)
+V8_TYPED_ARRAY_KIND(4, true, false, Int32Array)
+V8_TYPED_ARRAY_KIND(4, false, false, Uint32Array)
+#if V8_HAS_BIGINT
+V8_TYPED_ARRAY_KIND(8, true, false, BigInt64Array)
+V8_TYPED_ARRAY_KIND(8, false, false, BigUint64Array)
+#endif
+V8_TYPED_ARRAY_KIND(4, true, true, Float32Array)
+V8_TYPED_ARRAY_KIND(8, true, true, Float64Array)
+
+#undef V8_TYPED_ARRAY_KIND
+
+template<typename T, typename ENABLED = void>
+struct V8TypedArrayTraits
+{
+    static constexpr bool exists = false;
+};
+
+template<typename T>
+struct V8TypedArrayTraits<T,
+    typename std::enable_if<std::is_arithmetic<T>::value && !std::is_same<T, bool>::value>::type>
+    : V8TypedArrayKind<sizeof(T), std::is_signed<T>::value, std::is_floating_point<T>::value> {};
+
 template<typename T>
-struct V8TypeMapping<std::vector<T>>
+v8::Local<typename V8TypedArrayTraits<T>::ArrayType> V8TypedArrayNew(const T *data, size_t size)
 {
-    static v8::Local<v8::Array> set(const std::vector<T> &vector)
+    v8::EscapableHandleScope scope(v8::Isolate::GetCurrent());
+    auto bytes = size * sizeof(T);
+    auto buffer = v8::ArrayBuffer::New(v8::Isolate::GetCurrent(), bytes);
+    if (bytes > 0)
     {
-        v8::EscapableHandleScope scope(v8::Isolate::GetCurrent());
-        auto array = v8::Array::New(v8::Isolate::GetCurrent());
-        for (auto i = 0; i < vector.size(); ++i)
-        {
-            array->Set(static_cast<uint32_t>(i), V8Type<T>::set(vector[i]));
-        }
-        return scope.Escape(array);
+        memcpy(V8ArrayBufferData(buffer), data, bytes);
+    }
+    return scope.Escape(V8TypedArrayTraits<T>::ArrayType::New(buffer, 0, size));
+}
+
+/**
+ * std::vector of arithmetic type is mapped to the matching TypedArray, the elements are
+ * transferred with a single memcpy of the backing store instead of one property access each.
+ * A plain JS array is still accepted when reading, but converted element by element,
+ * any other value (including a TypedArray of another element type) throws a TypeError.
+ */
+template<typename T>
+struct V8TypeMapping<std::vector<T>,
+    typename std::enable_if<V8TypedArrayTraits<T>::exists>::type>
+{
+    using ArrayType = typename V8TypedArrayTraits<T>::ArrayType;
+
+    static v8::Local<ArrayType> set(const std::vector<T> &vector)
+    {
+        return V8TypedArrayNew(vector.data(), vector.size());
     }
 
     static std::vector<T> get(v8::MaybeLocal<v8::Value> handle)
     {
         v8::HandleScope scope(v8::Isolate::GetCurrent());
         std::vector<T> vector;
-        auto array = handle.ToLocalChecked().As<v8::Array>();
-        for (auto i = 0; i < array->Length(); ++i)
+        auto value = handle.ToLocalChecked();
+        if (V8TypedArrayTraits<T>::is(value))
+        {
+            auto array = value.As<ArrayType>();
+            vector.resize(array->Length());
+            if (!vector.empty())
+            {
+                array->CopyContents(vector.data(), vector.size() * sizeof(T));
+            }
+        }
+        else if (value->IsArray())
+        {
+            auto array = value.As<v8::Array>();
+            auto context = v8::Isolate::GetCurrent()->GetCurrentContext();
+            vector.reserve(array->Length());
+            for (uint32_t i = 0; i < array->Length(); ++i)
+            {
+                v8::Local<v8::Value> element;
+                if (!array->Get(context, i).ToLocal(&element))
+                {
+                    return std::vector<T>();
+                }
+                vector.push_back(V8Type<T>::get(element));
+            }
+        }
+        else
         {
-            vector.push_back(V8Type<T>::get(handle));
+            v8::Isolate::GetCurrent()->ThrowException(v8::Exception::TypeError(v8::String::NewFromUtf8(v8::Isolate::GetCurrent(), "except matching TypedArray or array", v8::NewStringType::kNormal).ToLocalChecked()));
         }
         return vector;
     }
@@ -297,37 +851,684 @@ struct V8TypeMapping<std::vector<T>>
     }
 };
 
-template<typename K, typename V>
-struct V8TypeMapping<std::map<K, V>>
+/**
+ * Create an array from already converted elements in one call, instead of one Set per element.
+ */
+inline v8::Local<v8::Array> V8ArrayNew(std::vector<v8::Local<v8::Value>> &elements)
 {
-    static v8::Local<v8::Object> set(const std::map<K, V> &map)
+#if V8_HAS_BULK_NEW
+    return v8::Array::New(v8::Isolate::GetCurrent(), elements.data(), elements.size());
+#else
+    v8::EscapableHandleScope scope(v8::Isolate::GetCurrent());
+    auto context = v8::Isolate::GetCurrent()->GetCurrentContext();
+    auto array = v8::Array::New(v8::Isolate::GetCurrent(), static_cast<int>(elements.size()));
+    for (size_t i = 0; i < elements.size(); ++i)
+    {
+        array->CreateDataProperty(context, static_cast<uint32_t>(i), elements[i]).FromJust();
+    }
+    return scope.Escape(array);
+#endif
+}
+
+template<typename T>
+struct V8TypeMapping<std::vector<T>,
+    typename std::enable_if<!V8TypedArrayTraits<T>::exists>::type>
+{
+    static v8::Local<v8::Array> set(const std::vector<T> &vector)
     {
         v8::EscapableHandleScope scope(v8::Isolate::GetCurrent());
-        auto object = v8::Object::New(v8::Isolate::GetCurrent());
-        for (auto &pair : map)
+        std::vector<v8::Local<v8::Value>> elements;
+        elements.reserve(vector.size());
+        for (auto &element : vector)
         {
-            object->Set(V8Type<K>::set(pair.first), V8Type<V>::set(pair.second));
+            elements.push_back(V8Type<T>::set(element));
         }
-        return scope.Escape(object);
+        return scope.Escape(V8ArrayNew(elements));
     }
 
-    static std::map<K, V> get(v8::MaybeLocal<v8::Value> handle)
+    static std::vector<T> get(v8::MaybeLocal<v8::Value> handle)
     {
         v8::HandleScope scope(v8::Isolate::GetCurrent());
-        std::map<K, V> map;
-        auto object = handle.ToLocalChecked().As<v8::Object>();
-        auto properties = object->GetPropertyNames();
-        for (auto i = 0; i < properties->Length(); ++i)
+        auto context = v8::Isolate::GetCurrent()->GetCurrentContext();
+        std::vector<T> vector;
+        auto array = handle.ToLocalChecked().As<v8::Array>();
+        auto length = array->Length();
+        vector.reserve(length);
+        for (uint32_t i = 0; i < length; ++i)
         {
-            auto key = properties->Get(static_cast<uint32_t>(i));
-            auto value = object->Get(key);
-            map.insert(V8Type<K>::get(key), V8Type<V>::get(value));
+            vector.push_back(V8Type<T>::get(array->Get(context, i)));
         }
-        return map;
+        return vector;
     }
 
-    static std::map<K, V> opt(v8::MaybeLocal<v8::Value> handle, const std::map<K, V> &def)
+    static std::vector<T> opt(v8::MaybeLocal<v8::Value> handle, const std::vector<T> &def)
     {
         return handle.ToLocalChecked()->IsUndefined() ? def : get(handle);
     }
-};
\ No newline at end of file
+};
+
+/**
+ * Representation policies for associative containers:
+ * V8ContainerAsObject writes a plain object (maps) and V8ContainerAsArray writes an array (sets),
+ * V8ContainerAsCollection writes a JS Map or Set. Reading accepts any of these forms.
+ */
+struct V8ContainerAsObject {};
+
+struct V8ContainerAsArray {};
+
+struct V8ContainerAsCollection {};
+
+struct V8ContainerReserve
+{
+    template<typename C>
+    static auto reserve(C &c, size_t n, int) -> decltype(c.reserve(n), void())
+    {
+        c.reserve(n);
+    }
+
+    template<typename C>
+    static void reserve(C &, size_t, long) {}
+};
+
+template<typename M, typename POLICY>
+struct V8MapTypeMapping
+{
+    using KeyType = typename M::key_type;
+    using ValueType = typename M::mapped_type;
+
+    static v8::Local<v8::Object> set(const M &map)
+    {
+        return setAs(map, POLICY());
+    }
+
+    static M get(v8::MaybeLocal<v8::Value> handle)
+    {
+        v8::HandleScope scope(v8::Isolate::GetCurrent());
+        auto context = v8::Isolate::GetCurrent()->GetCurrentContext();
+        M map;
+        auto value = handle.ToLocalChecked();
+        if (value->IsMap())
+        {
+            auto entries = value.As<v8::Map>()->AsArray();
+            auto length = entries->Length();
+            V8ContainerReserve::reserve(map, length / 2, 0);
+            for (uint32_t i = 0; i + 1 < length; i += 2)
+            {
+                map.emplace_hint(map.end(), V8Type<KeyType>::get(entries->Get(context, i)), V8Type<ValueType>::get(entries->Get(context, i + 1)));
+            }
+        }
+        else if (value->IsObject())
+        {
+            auto object = value.As<v8::Object>();
+            v8::Local<v8::Array> keys;
+            if (!object->GetOwnPropertyNames(context).ToLocal(&keys))
+            {
+                return map;
+            }
+            auto length = keys->Length();
+            V8ContainerReserve::reserve(map, length, 0);
+            for (uint32_t i = 0; i < length; ++i)
+            {
+                auto key = keys->Get(context, i).ToLocalChecked();
+                map.emplace_hint(map.end(), V8Type<KeyType>::get(key), V8Type<ValueType>::get(object->Get(context, key)));
+            }
+        }
+        return map;
+    }
+
+    static M opt(v8::MaybeLocal<v8::Value> handle, const M &def)
+    {
+        return handle.ToLocalChecked()->IsUndefined() ? def : get(handle);
+    }
+
+private:
+    static v8::Local<v8::Object> setAs(const M &map, V8ContainerAsObject)
+    {
+        v8::EscapableHandleScope scope(v8::Isolate::GetCurrent());
+        auto context = v8::Isolate::GetCurrent()->GetCurrentContext();
+#if V8_HAS_BULK_NEW
+        std::vector<v8::Local<v8::Name>> names;
+        std::vector<v8::Local<v8::Value>> values;
+        names.reserve(map.size());
+        values.reserve(map.size());
+        for (auto &pair : map)
+        {
+            names.push_back(v8::Local<v8::Value>(V8Type<KeyType>::set(pair.first))->ToString(context).ToLocalChecked());
+            values.push_back(V8Type<ValueType>::set(pair.second));
+        }
+        return scope.Escape(v8::Object::New(v8::Isolate::GetCurrent(), v8::Object::New(v8::Isolate::GetCurrent())->GetPrototype(), names.data(), values.data(), names.size()));
+#else
+        auto object = v8::Object::New(v8::Isolate::GetCurrent());
+        for (auto &pair : map)
+        {
+            object->Set(context, V8Type<KeyType>::set(pair.first), V8Type<ValueType>::set(pair.second)).FromJust();
+        }
+        return scope.Escape(object);
+#endif
+    }
+
+    static v8::Local<v8::Object> setAs(const M &map, V8ContainerAsCollection)
+    {
+        v8::EscapableHandleScope scope(v8::Isolate::GetCurrent());
+        auto context = v8::Isolate::GetCurrent()->GetCurrentContext();
+        auto result = v8::Map::New(v8::Isolate::GetCurrent());
+        for (auto &pair : map)
+        {
+            result->Set(context, V8Type<KeyType>::set(pair.first), V8Type<ValueType>::set(pair.second)).ToLocalChecked();
+        }
+        return scope.Escape(result);
+    }
+};
+
+template<typename S, typename POLICY>
+struct V8SetTypeMapping
+{
+    using KeyType = typename S::key_type;
+
+    static v8::Local<v8::Object> set(const S &set)
+    {
+        return setAs(set, POLICY());
+    }
+
+    static S get(v8::MaybeLocal<v8::Value> handle)
+    {
+        v8::HandleScope scope(v8::Isolate::GetCurrent());
+        auto context = v8::Isolate::GetCurrent()->GetCurrentContext();
+        S set;
+        auto value = handle.ToLocalChecked();
+        v8::Local<v8::Array> array;
+        if (value->IsSet())
+        {
+            array = value.As<v8::Set>()->AsArray();
+        }
+        else if (value->IsArray())
+        {
+            array = value.As<v8::Array>();
+        }
+        else
+        {
+            return set;
+        }
+        auto length = array->Length();
+        V8ContainerReserve::reserve(set, length, 0);
+        for (uint32_t i = 0; i < length; ++i)
+        {
+            set.emplace_hint(set.end(), V8Type<KeyType>::get(array->Get(context, i)));
+        }
+        return set;
+    }
+
+    static S opt(v8::MaybeLocal<v8::Value> handle, const S &def)
+    {
+        return handle.ToLocalChecked()->IsUndefined() ? def : get(handle);
+    }
+
+private:
+    static v8::Local<v8::Object> setAs(const S &set, V8ContainerAsArray)
+    {
+        v8::EscapableHandleScope scope(v8::Isolate::GetCurrent());
+        std::vector<v8::Local<v8::Value>> elements;
+        elements.reserve(set.size());
+        for (auto &key : set)
+        {
+            elements.push_back(V8Type<KeyType>::set(key));
+        }
+        return scope.Escape(V8ArrayNew(elements));
+    }
+
+    static v8::Local<v8::Object> setAs(const S &set, V8ContainerAsCollection)
+    {
+        v8::EscapableHandleScope scope(v8::Isolate::GetCurrent());
+        auto context = v8::Isolate::GetCurrent()->GetCurrentContext();
+        auto result = v8::Set::New(v8::Isolate::GetCurrent());
+        for (auto &key : set)
+        {
+            result->Add(context, V8Type<KeyType>::set(key)).ToLocalChecked();
+        }
+        return scope.Escape(result);
+    }
+};
+
+template<typename K, typename V, typename C, typename A>
+struct V8TypeMapping<std::map<K, V, C, A>>
+    : V8MapTypeMapping<std::map<K, V, C, A>, V8ContainerAsObject> {};
+
+template<typename K, typename V, typename H, typename E, typename A>
+struct V8TypeMapping<std::unordered_map<K, V, H, E, A>>
+    : V8MapTypeMapping<std::unordered_map<K, V, H, E, A>, V8ContainerAsObject> {};
+
+template<typename K, typename C, typename A>
+struct V8TypeMapping<std::set<K, C, A>>
+    : V8SetTypeMapping<std::set<K, C, A>, V8ContainerAsArray> {};
+
+template<typename K, typename H, typename E, typename A>
+struct V8TypeMapping<std::unordered_set<K, H, E, A>>
+    : V8SetTypeMapping<std::unordered_set<K, H, E, A>, V8ContainerAsArray> {};
+
+/**
+ * Pick the JS representation of a container for a single binding, e.g.
+ * V8_ARGS(V8Container<std::unordered_map<std::string, int>, V8ContainerAsCollection>)
+ * or as the return type of a bound function.
+ */
+template<typename C, typename POLICY>
+struct V8Container : C
+{
+    V8Container() {}
+
+    V8Container(const C &c) : C(c) {}
+
+    V8Container(C &&c) : C(std::move(c)) {}
+};
+
+template<typename C, typename POLICY, typename ENABLED = void>
+struct V8ContainerTypeMapping
+    : V8SetTypeMapping<C, POLICY> {};
+
+template<typename C, typename POLICY>
+struct V8ContainerTypeMapping<C, POLICY, typename std::enable_if<sizeof(typename C::mapped_type) != 0>::type>
+    : V8MapTypeMapping<C, POLICY> {};
+
+template<typename C, typename POLICY>
+struct V8TypeMapping<V8Container<C, POLICY>>
+    : V8ContainerTypeMapping<C, POLICY> {};
+
+/**
+ * Non-owning view of a contiguous range of T, used to receive ArrayBuffer, TypedArray or
+ * DataView contents without copying. The view aliases the backing store of the JS buffer,
+ * so it is only valid while the buffer is alive and not detached (e.g. for the duration of
+ * a bound function call).
+ */
+template<typename T>
+class V8Span
+{
+public:
+    V8Span() {}
+
+    V8Span(T *data, size_t size) : ptr(data), length(size) {}
+
+    template<typename U, typename = typename std::enable_if<std::is_convertible<U *, T *>::value>::type>
+    V8Span(const V8Span<U> &that) : ptr(that.data()), length(that.size()) {}
+
+    T *data() const
+    {
+        return ptr;
+    }
+
+    size_t size() const
+    {
+        return length;
+    }
+
+    size_t sizeInBytes() const
+    {
+        return length * sizeof(T);
+    }
+
+    bool empty() const
+    {
+        return length == 0;
+    }
+
+    T &operator[](size_t index) const
+    {
+        assert(index < length);
+        return ptr[index];
+    }
+
+    T *begin() const
+    {
+        return ptr;
+    }
+
+    T *end() const
+    {
+        return ptr + length;
+    }
+
+private:
+    T *ptr{ nullptr };
+    size_t length{ 0 };
+};
+
+using V8BytesView = V8Span<unsigned char>;
+
+template<typename T>
+struct V8TypeIsView<V8Span<T>>
+    : std::true_type {};
+
+template<typename T>
+struct V8SpanTypeCheck
+{
+    template<typename E = T>
+    static typename std::enable_if<V8TypedArrayTraits<E>::exists && sizeof(E) != 1, bool>::type
+    check(v8::Local<v8::Value> value)
+    {
+        return !value->IsTypedArray() || V8TypedArrayTraits<E>::is(value);
+    }
+
+    template<typename E = T>
+    static typename std::enable_if<!V8TypedArrayTraits<E>::exists || sizeof(E) == 1, bool>::type
+    check(v8::Local<v8::Value>)
+    {
+        return true;
+    }
+};
+
+template<typename T>
+struct V8TypeMapping<V8Span<T>>
+{
+    using ElementType = typename std::remove_const<T>::type;
+
+    static v8::Local<v8::Value> set(const V8Span<T> &span)
+    {
+        return setArray(span);
+    }
+
+    static V8Span<T> get(v8::MaybeLocal<v8::Value> handle)
+    {
+        auto value = handle.ToLocalChecked();
+        v8::Local<v8::ArrayBuffer> buffer;
+        size_t offset = 0;
+        size_t bytes = 0;
+        if (value->IsArrayBufferView() && V8SpanTypeCheck<ElementType>::check(value))
+        {
+            auto view = value.As<v8::ArrayBufferView>();
+            buffer = view->Buffer();
+            offset = view->ByteOffset();
+            bytes = view->ByteLength();
+        }
+        else if (value->IsArrayBuffer())
+        {
+            buffer = value.As<v8::ArrayBuffer>();
+            bytes = buffer->ByteLength();
+        }
+        else
+        {
+            v8::Isolate::GetCurrent()->ThrowException(v8::Exception::TypeError(v8::String::NewFromUtf8(v8::Isolate::GetCurrent(), "except ArrayBuffer or matching ArrayBufferView", v8::NewStringType::kNormal).ToLocalChecked()));
+            return V8Span<T>();
+        }
+        if (bytes == 0)
+        {
+            return V8Span<T>();
+        }
+        auto data = static_cast<unsigned char *>(V8ArrayBufferData(buffer)) + offset;
+        if (reinterpret_cast<uintptr_t>(data) % alignof(ElementType) != 0 || bytes % sizeof(ElementType) != 0)
+        {
+            v8::Isolate::GetCurrent()->ThrowException(v8::Exception::TypeError(v8::String::NewFromUtf8(v8::Isolate::GetCurrent(), "except buffer aligned to element type", v8::NewStringType::kNormal).ToLocalChecked()));
+            return V8Span<T>();
+        }
+        return V8Span<T>(reinterpret_cast<ElementType *>(data), bytes / sizeof(ElementType));
+    }
+
+    static V8Span<T> opt(v8::MaybeLocal<v8::Value> handle, const V8Span<T> &def)
+    {
+        return handle.ToLocalChecked()->IsUndefined() ? def : get(handle);
+    }
+
+private:
+    template<typename E = ElementType>
+    static typename std::enable_if<V8TypedArrayTraits<E>::exists, v8::Local<v8::Value>>::type
+    setArray(const V8Span<T> &span)
+    {
+        return V8TypedArrayNew<E>(span.data(), span.size());
+    }
+
+    template<typename E = ElementType>
+    static typename std::enable_if<!V8TypedArrayTraits<E>::exists, v8::Local<v8::Value>>::type
+    setArray(const V8Span<T> &span)
+    {
+        v8::EscapableHandleScope scope(v8::Isolate::GetCurrent());
+        auto buffer = v8::ArrayBuffer::New(v8::Isolate::GetCurrent(), span.sizeInBytes());
+        if (!span.empty())
+        {
+            memcpy(V8ArrayBufferData(buffer), span.data(), span.sizeInBytes());
+        }
+        return scope.Escape(buffer);
+    }
+};
+
+/**
+ * Non-owning view of UTF-8 string data, the std::string_view of the binding layer.
+ * Returning a view to V8 creates a string with explicit length, so embedded NULs are kept.
+ * A view received as a bound function argument points into storage owned by the argument
+ * holder and is valid for the duration of the call.
+ */
+class V8StringView
+{
+public:
+    V8StringView() {}
+
+    V8StringView(const char *data, size_t size) : ptr(data), length(size) {}
+
+    V8StringView(const char *str) : ptr(str), length(str ? strlen(str) : 0) {}
+
+    V8StringView(const std::string &str) : ptr(str.data()), length(str.size()) {}
+
+    const char *data() const
+    {
+        return ptr;
+    }
+
+    size_t size() const
+    {
+        return length;
+    }
+
+    bool empty() const
+    {
+        return length == 0;
+    }
+
+    char operator[](size_t index) const
+    {
+        assert(index < length);
+        return ptr[index];
+    }
+
+    const char *begin() const
+    {
+        return ptr;
+    }
+
+    const char *end() const
+    {
+        return ptr + length;
+    }
+
+    std::string str() const
+    {
+        return std::string(ptr, length);
+    }
+
+    bool operator==(const V8StringView &that) const
+    {
+        return length == that.length && (length == 0 || memcmp(ptr, that.ptr, length) == 0);
+    }
+
+    bool operator!=(const V8StringView &that) const
+    {
+        return !(*this == that);
+    }
+
+private:
+    const char *ptr{ "" };
+    size_t length{ 0 };
+};
+
+template<>
+struct V8TypeIsView<V8StringView>
+    : std::true_type {};
+
+template<>
+struct V8TypeMapping<V8StringView>
+{
+    static v8::Local<v8::String> set(const V8StringView &str)
+    {
+        return V8StringConverter::create(str.data(), str.size());
+    }
+
+    /**
+     * The returned view points into the storage given by the caller,
+     * bound function arguments use the storage of their argument holder.
+     * Without storage, it points into the per-thread buffer, valid until the next such conversion.
+     */
+    static V8StringView get(v8::MaybeLocal<v8::Value> handle, std::string &storage)
+    {
+        v8::HandleScope scope(v8::Isolate::GetCurrent());
+        V8StringConverter::read(handle.ToLocalChecked(), storage);
+        return V8StringView(storage);
+    }
+
+    static V8StringView opt(v8::MaybeLocal<v8::Value> handle, const V8StringView &def, std::string &storage)
+    {
+        return handle.ToLocalChecked()->IsUndefined() ? def : get(handle, storage);
+    }
+
+    static V8StringView get(v8::MaybeLocal<v8::Value> handle)
+    {
+        return get(handle, V8StringConverter::localBuffer());
+    }
+
+    static V8StringView opt(v8::MaybeLocal<v8::Value> handle, const V8StringView &def)
+    {
+        return opt(handle, def, V8StringConverter::localBuffer());
+    }
+};
+
+template<typename BASE, typename CHAR, typename OWNER>
+class V8ExternalStringResource : public BASE
+{
+public:
+    V8ExternalStringResource(const std::shared_ptr<OWNER> &owner, const CHAR *data, size_t length)
+        : owner(owner), ptr(data), size(length) {}
+
+    virtual const CHAR *data() const override
+    {
+        return ptr;
+    }
+
+    virtual size_t length() const override
+    {
+        return size;
+    }
+
+private:
+    std::shared_ptr<OWNER> owner;
+    const CHAR *ptr;
+    size_t size;
+};
+
+/**
+ * Immutable C++-owned string exposed to V8 as an external string, so the bytes are never copied
+ * into the V8 heap. The content is ref-counted: every external string created from it holds a
+ * reference through its resource, which V8 releases when the string is collected. The last JS
+ * string is kept in a weak handle together with its isolate, so returning the same V8ExternalString
+ * again in that isolate reuses it, other isolates get a new external string that is not cached.
+ * Empty content is returned as the empty string without an external resource.
+ * ASCII content is exposed as a one-byte string, other UTF-8 content is transcoded to UTF-16 once.
+ */
+class V8ExternalString
+{
+public:
+    V8ExternalString() {}
+
+    explicit V8ExternalString(std::string str) : state(std::make_shared<State>())
+    {
+        if (V8StringConverter::isAscii(str.data(), str.size()))
+        {
+            state->oneByte = std::move(str);
+        }
+        else
+        {
+            state->twoByte = V8StringConverter::toUtf16(str.data(), str.size());
+            state->isTwoByte = true;
+        }
+    }
+
+    explicit V8ExternalString(std::u16string str) : state(std::make_shared<State>())
+    {
+        state->twoByte = std::move(str);
+        state->isTwoByte = true;
+    }
+
+    bool empty() const
+    {
+        return !state || (state->isTwoByte ? state->twoByte.empty() : state->oneByte.empty());
+    }
+
+    v8::Local<v8::String> handle() const
+    {
+        auto isolate = v8::Isolate::GetCurrent();
+        v8::EscapableHandleScope scope(isolate);
+        if (empty())
+        {
+            return scope.Escape(v8::String::Empty(isolate));
+        }
+        if (!state->cache.IsEmpty())
+        {
+            if (state->isolate == isolate)
+            {
+                return scope.Escape(state->cache.Get(isolate));
+            }
+            return scope.Escape(create(isolate));
+        }
+        auto str = create(isolate);
+        state->isolate = isolate;
+        state->cache.Reset(isolate, str);
+        state->cache.SetWeak(state.get(), &State::release, v8::WeakCallbackType::kParameter);
+        return scope.Escape(str);
+    }
+
+private:
+    struct State
+    {
+        static void release(const v8::WeakCallbackInfo<State> &data)
+        {
+            data.GetParameter()->cache.Reset();
+            data.GetParameter()->isolate = nullptr;
+        }
+
+        std::string oneByte;
+        std::u16string twoByte;
+        bool isTwoByte{ false };
+        v8::Isolate *isolate{ nullptr };
+        v8::Global<v8::String> cache;
+    };
+
+    v8::Local<v8::String> create(v8::Isolate *isolate) const
+    {
+        if (state->isTwoByte)
+        {
+            using Resource = V8ExternalStringResource<v8::String::ExternalStringResource, uint16_t, State>;
+            auto resource = new Resource(state, reinterpret_cast<const uint16_t *>(state->twoByte.data()), state->twoByte.size());
+            return v8::String::NewExternalTwoByte(isolate, resource).ToLocalChecked();
+        }
+        else
+        {
+            using Resource = V8ExternalStringResource<v8::String::ExternalOneByteStringResource, char, State>;
+            auto resource = new Resource(state, state->oneByte.data(), state->oneByte.size());
+            return v8::String::NewExternalOneByte(isolate, resource).ToLocalChecked();
+        }
+    }
+
+    std::shared_ptr<State> state;
+};
+
+template<>
+struct V8TypeMapping<V8ExternalString>
+{
+    static v8::Local<v8::String> set(const V8ExternalString &str)
+    {
+        return str.handle();
+    }
+
+    static V8ExternalString get(v8::MaybeLocal<v8::Value> handle)
+    {
+        return V8ExternalString(V8TypeMapping<std::string>::get(handle));
+    }
+
+    static V8ExternalString opt(v8::MaybeLocal<v8::Value> handle, const V8ExternalString &def)
+    {
+        return handle.ToLocalChecked()->IsUndefined() ? def : get(handle);
+    }
+};
@@ -1,9 +1,18 @@
 #include "include/CppArg.h"
 #include "include/CppBindClass.h"
 #include "include/CppBindModule.h"
+#include "include/CppBindOverload.h"
+#include "include/CppFastCall.h"
 #include "include/CppFunction.h"
 #include "include/CppInvoke.h"
 #include "include/CppObject.h"
+#include "include/V8Async.h"
+#include "include/V8ContainerRef.h"
+#include "include/V8Coroutine.h"
+#include "include/V8Executor.h"
+#include "include/V8Function.h"
+#include "include/V8Isolate.h"
+#include "include/V8ObjectView.h"
 #include "include/V8Type.h"
 
 #include <v8.h>
@@ -22,6 +31,16 @@ public:
     std::string name;
 };
 
+#if V8_BINDING_COROUTINE
+V8Generator<int> range(int n)
+{
+    for (int i = 0; i < n; ++i)
+    {
+        co_yield i;
+    }
+}
+#endif
+
 class ArrayBufferAllocator : public v8::ArrayBuffer::Allocator
 {
 public:
@@ -68,6 +87,15 @@ int main(int argc, char *argv[])
                 .endClass()
             .endModule();
     }
+#if V8_BINDING_COROUTINE
+    {
+        V8Binding(v8::Isolate::GetCurrent()->GetCurrentContext()->Global())
+            .beginModule("Module")
+                .addFunction("range", &range)
+            .endModule();
+    }
+#endif
+    V8IsolateData::dispose(mIsolate);
     mIsolate->Exit();
     mIsolate->Dispose();
     v8::V8::Dispose();